@@ -0,0 +1,2700 @@
+/* The MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+
+   contact: Pierre Lindenbaum PhD @yokofakun
+
+History:
+   * 2014 first commit
+   * Sept 2014: fixed new format for GNU-Make v4. ( https://github.com/lindenb/makefile2graph/issues/1 )
+   * Sept 2014: added long_opt , options basename and suffix
+   * Nov  2014: added option to hide ROOT node
+   * Dec  2014: new output. Print the deepest independant targets
+   * Desc 2014: MacOS bug, changed options
+   * Aug  2023: colorscheme, graph, node, and edge attributes
+   * 2026: parser and graph moved to libmake2graph, push-style parser
+   * 2026: --max-nodes, --max-depth and --timeout stop the parser early
+   * 2026: strongly connected components, the deep output is linear and safe on cycles
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "make2graph.h"
+
+#define OUT_OF_MEMORY do { fprintf(stderr,"%s: %d : OUT_OF_MEMORY.\n",__FILE__,__LINE__); exit(EXIT_FAILURE);} while(0)
+
+/* as https://github.com/lindenb/makefile2graph/issues/9 */
+static char* StrNDup (const char *s, size_t n)
+{
+  char *result;
+  size_t len = strlen (s);
+
+  if (n < len)
+    len = n;
+
+  result = (char *) malloc (len + 1);
+  if (!result)
+    return 0;
+
+  result[len] = '\0';
+  return (char *) memcpy (result, s, len);
+}
+
+/** strdup that accepts NULL */
+static char* StrDupOrNull(const char* s)
+	{
+	char* p;
+	if(s==NULL) return NULL;
+	p=strdup(s);
+	if(p==NULL) OUT_OF_MEMORY;
+	return p;
+	}
+
+/** a block of memory of the string pool */
+typedef struct pool_block_t
+	{
+	struct pool_block_t* next;
+	/** bytes used in data */
+	size_t used;
+	/** size of data */
+	size_t size;
+	char data[];
+	}PoolBlock,*PoolBlockPtr;
+
+/** size of a block of the string pool */
+#define POOL_BLOCK_SIZE (1<<16)
+
+/** the directories of the targets are stored in a trie of path components:
+ * build/x86_64/a.o and build/x86_64/b.o share the directories 'build' and 'x86_64'.
+ * a target only stores the last component of its name (its leaf) */
+typedef struct dir_node_t
+	{
+	/** parent directory, NULL for the first component */
+	struct dir_node_t* parent;
+	/** this component, in the string pool, without '/' */
+	const char* component;
+	/** length of component */
+	size_t length;
+	/** length of the full path of the directory */
+	size_t path_length;
+	/** number of directories above this one */
+	size_t depth;
+	/** next directory in the same bucket of the hash table */
+	struct dir_node_t* next;
+	}DirNode,*DirNodePtr;
+
+/** a Target */
+struct target_t
+	{
+	/* target id */
+	size_t id;
+	/* directory of the filename or NULL */
+	DirNodePtr dir;
+	/* last component of the filename, in the string pool */
+	const char* leaf;
+	/* associated children, sorted by name */
+	struct target_t** children;
+	/* number of children */
+	size_t n_children;
+	/* number of children */
+	size_t level;
+	/* position in graph->targets */
+	size_t index;
+	/* strongly connected component, only valid after GraphComponents */
+	size_t component;
+	/* target is dirty */
+	int must_remake;
+	/* deep target, only valid while DumpGraphAsDeep is running */
+	int deep;
+	};
+
+/** a pending 'Considering target file' of the parser, was a recursive call of GraphScan */
+typedef struct scan_frame_t
+	{
+	/** target being considered */
+	TargetPtr root;
+	/** expected indentation of its prerequisites */
+	size_t level;
+	/** last makefile read at this level */
+	char* makefile_name;
+	}ScanFrame,*ScanFramePtr;
+
+/** the Makefile graph */
+struct make2graph_t
+	{
+	/** all the targets , sorted by name */
+	TargetPtr* targets;
+	/** number of target */
+	size_t target_count;
+	/** root target */
+	TargetPtr root;
+	/** target id-generator */
+	size_t id_generator;
+	/** targets are sorted by name, they're appended while parsing */
+	int sorted;
+	/** hash table of the targets by name: 1 + position in targets, 0 for an empty slot.
+	 * rebuilt when the targets are sorted */
+	uint32_t* target_slots;
+	/** number of slots, a power of 2 */
+	size_t target_slot_count;
+	/** hash table of the directories */
+	DirNodePtr* dir_buckets;
+	/** number of buckets, a power of 2 */
+	size_t dir_bucket_count;
+	/** number of directories */
+	size_t dir_count;
+	/** memory of the directories and of the leaves */
+	PoolBlockPtr pool;
+	/** cached reverse edges (see GraphParents): the targets depending on targets[i]
+	 * are parents[parent_offsets[i]..parent_offsets[i+1]-1]. NULL when the graph changed */
+	TargetPtr* parents;
+	/** offsets in parents, target_count+1 items */
+	size_t* parent_offsets;
+	/** flag print only basename */
+	int print_basename_only;
+	/** flag print only extension */
+	int print_suffix_only;
+	/** show <root> node https://github.com/lindenb/makefile2graph/issues/3 */
+	int show_root;
+	/** sets colorscheme applied interleaved to all nodes */
+	char *colorscheme;
+	/** sets attributes applied to the graph */
+	char *graph_attributes;
+	/** sets attributes applied to all nodes */
+	char *node_attributes;
+	/** sets attributes applied to all edges */
+	char *edge_attributes;
+	/** sets attributes applied to dirty nodes only */
+	char *dirty_attributes;
+	/** number of threads used to render the output */
+	int threads;
+	/** makefiles read by make */
+	char** makefiles;
+	/** number of makefiles */
+	size_t makefile_count;
+	/** parser: current incomplete line, leading spaces removed */
+	char* line;
+	/** parser: length of line */
+	size_t line_len;
+	/** parser: allocated size of line */
+	size_t line_capacity;
+	/** parser: number of leading spaces of line */
+	size_t line_level;
+	/** parser: stack of targets being considered */
+	ScanFramePtr frames;
+	/** parser: number of frames */
+	size_t frame_count;
+	/** parser: allocated number of frames */
+	size_t frame_capacity;
+	/** parser: skipping the lines of the makefile of the top frame */
+	int skip_makefile;
+	/** parser: root target was finished, ignore the remaining lines */
+	int done;
+	/** parser: number of nested targets being skipped because they are deeper than max_depth */
+	size_t skip_depth;
+	/** parser: number of lines scanned */
+	size_t line_count;
+	/** stop parsing after this number of targets, 0 for no limit */
+	size_t max_nodes;
+	/** targets deeper than this are skipped, 0 for no limit */
+	size_t max_depth;
+	/** stop parsing at this time (see MonotonicTime), 0 for no limit */
+	double deadline;
+	/** why the parser stopped early or NULL */
+	const char* truncated;
+	/** last error or NULL */
+	char* error;
+	};
+
+
+/** allocate 'n' bytes in the string pool of the graph, aligned for a pointer if 'aligned' */
+static void* PoolAlloc(GraphPtr g,size_t n,int aligned)
+	{
+	void* p;
+	if(aligned && g->pool!=NULL)
+		{
+		/* keep the pointers aligned */
+		g->pool->used=(g->pool->used+sizeof(void*)-1)&~(sizeof(void*)-1);
+		}
+	if(g->pool==NULL || g->pool->used+n > g->pool->size)
+		{
+		size_t size=(n>POOL_BLOCK_SIZE?n:POOL_BLOCK_SIZE);
+		PoolBlockPtr b=(PoolBlockPtr)malloc(sizeof(PoolBlock)+size);
+		if(b==NULL) OUT_OF_MEMORY;
+		b->next=g->pool;
+		b->used=0UL;
+		b->size=size;
+		g->pool=b;
+		}
+	p=&g->pool->data[g->pool->used];
+	g->pool->used+=n;
+	return p;
+	}
+
+/** copy 'len' chars of 's' in the string pool, with a final '\0' */
+static const char* PoolStrNDup(GraphPtr g,const char* s,size_t len)
+	{
+	char* copy=(char*)PoolAlloc(g,len+1,0);
+	memcpy(copy,s,len);
+	copy[len]=0;
+	return copy;
+	}
+
+/** hash of a name in a directory */
+static size_t NameHash(const DirNode* parent,const char* s,size_t len)
+	{
+	size_t i,h=(size_t)parent;
+	h^=h>>7;
+	for(i=0;i< len;++i)
+		{
+		h=(h^(unsigned char)s[i])*(size_t)1099511628211ULL;
+		}
+	return h;
+	}
+
+/** find the directory 's' in 'parent', NULL if it doesn't exist */
+static DirNodePtr GraphDirChild(const Graph* g,const DirNode* parent,const char* s,size_t len)
+	{
+	DirNodePtr n;
+	if(g->dir_bucket_count==0) return NULL;
+	for(n=g->dir_buckets[NameHash(parent,s,len)&(g->dir_bucket_count-1)];n!=NULL;n=n->next)
+		{
+		if(n->parent==parent && n->length==len && memcmp(n->component,s,len)==0) return n;
+		}
+	return NULL;
+	}
+
+/** find the directory 's' in 'parent', creates it if 'create' is true */
+static DirNodePtr GraphDirNode(GraphPtr g,DirNodePtr parent,const char* s,size_t len,int create)
+	{
+	DirNodePtr n=GraphDirChild(g,parent,s,len);
+	size_t h;
+	if(n!=NULL || !create) return n;
+	h=NameHash(parent,s,len);
+	if(g->dir_count>=g->dir_bucket_count/2)
+		{
+		/* rehash */
+		size_t i,count=(g->dir_bucket_count==0?64:g->dir_bucket_count*2);
+		DirNodePtr* buckets=(DirNodePtr*)calloc(count,sizeof(DirNodePtr));
+		if(buckets==NULL) OUT_OF_MEMORY;
+		for(i=0;i< g->dir_bucket_count;++i)
+			{
+			while((n=g->dir_buckets[i])!=NULL)
+				{
+				size_t j=NameHash(n->parent,n->component,n->length)&(count-1);
+				g->dir_buckets[i]=n->next;
+				n->next=buckets[j];
+				buckets[j]=n;
+				}
+			}
+		free(g->dir_buckets);
+		g->dir_buckets=buckets;
+		g->dir_bucket_count=count;
+		}
+	n=(DirNodePtr)PoolAlloc(g,sizeof(DirNode),1);
+	n->parent=parent;
+	n->component=PoolStrNDup(g,s,len);
+	n->length=len;
+	n->path_length=(parent==NULL?len:parent->path_length+1+len);
+	n->depth=(parent==NULL?0:parent->depth+1);
+	n->next=g->dir_buckets[h&(g->dir_bucket_count-1)];
+	g->dir_buckets[h&(g->dir_bucket_count-1)]=n;
+	g->dir_count++;
+	return n;
+	}
+
+/** find the directory made of the 'len' first characters of 's', NULL if it doesn't exist */
+static DirNodePtr GraphDirFind(const Graph* g,const char* s,size_t len)
+	{
+	DirNodePtr n=NULL;
+	const char* end=s+len;
+	for(;;)
+		{
+		const char* slash=(const char*)memchr(s,'/',(size_t)(end-s));
+		n=GraphDirChild(g,n,s,(size_t)((slash==NULL?end:slash)-s));
+		if(n==NULL || slash==NULL) return n;
+		s=slash+1;
+		}
+	}
+
+/** get the directory made of the 'len' first characters of 's', creates it and its parents if needed */
+static DirNodePtr GraphDir(GraphPtr g,const char* s,size_t len)
+	{
+	DirNodePtr n=NULL;
+	const char* end=s+len;
+	for(;;)
+		{
+		const char* slash=(const char*)memchr(s,'/',(size_t)(end-s));
+		n=GraphDirNode(g,n,s,(size_t)((slash==NULL?end:slash)-s),1);
+		if(slash==NULL) return n;
+		s=slash+1;
+		}
+	}
+
+/** copy a directory of another graph in this graph, NULL if it doesn't exist and !create */
+static DirNodePtr GraphDirCopy(GraphPtr g,const DirNodePtr n,int create)
+	{
+	DirNodePtr parent=NULL;
+	if(n==NULL) return NULL;
+	if(n->parent!=NULL)
+		{
+		parent=GraphDirCopy(g,n->parent,create);
+		if(parent==NULL) return NULL;
+		}
+	return GraphDirNode(g,parent,n->component,n->length,create);
+	}
+
+/** write the directory so that it ends at 'end' (no final '\0'), returns its first character */
+static char* DirCopy(const DirNodePtr n,char* end)
+	{
+	DirNodePtr p;
+	for(p=n;p!=NULL;p=p->parent)
+		{
+		end-=p->length;
+		memcpy(end,p->component,p->length);
+		if(p->parent!=NULL) *--end='/';
+		}
+	return end;
+	}
+
+/** length of the full name of a target */
+static size_t TargetPathLength(const Target* t)
+	{
+	return (t->dir==NULL?0:t->dir->path_length+1)+strlen(t->leaf);
+	}
+
+/** write the full name of a target in 'buf', which must contain TargetPathLength+1 bytes */
+static void TargetPathCopy(const Target* t,char* buf)
+	{
+	if(t->dir!=NULL)
+		{
+		DirCopy(t->dir,&buf[t->dir->path_length]);
+		buf[t->dir->path_length]='/';
+		buf+=t->dir->path_length+1;
+		}
+	strcpy(buf,t->leaf);
+	}
+
+/** the full name of a target, must be released with free */
+static char* TargetPathDup(const Target* t)
+	{
+	char* p=(char*)malloc(TargetPathLength(t)+1);
+	if(p==NULL) OUT_OF_MEMORY;
+	TargetPathCopy(t,p);
+	return p;
+	}
+
+/** is the full name of the target equals to 's' */
+static int TargetNameEquals(const Target* t,const char* s)
+	{
+	DirNodePtr p;
+	size_t len=strlen(s);
+	size_t leaf_len=strlen(t->leaf);
+	if(len!=TargetPathLength(t)) return 0;
+	len-=leaf_len;
+	if(memcmp(&s[len],t->leaf,leaf_len)!=0) return 0;
+	for(p=t->dir;p!=NULL;p=p->parent)
+		{
+		if(s[--len]!='/') return 0;
+		len-=p->length;
+		if(memcmp(&s[len],p->component,p->length)!=0) return 0;
+		}
+	return 1;
+	}
+
+/** compare two path components followed by the characters 'next1' and 'next2' ('/' in a directory, 0 at the end) */
+static int ComponentCmp(const char* s1,size_t l1,int next1,const char* s2,size_t l2,int next2)
+	{
+	size_t m=(l1 < l2 ? l1 : l2);
+	int r=memcmp(s1,s2,m);
+	if(r!=0) return r;
+	return (l1>m?(unsigned char)s1[m]:next1)-(l2>m?(unsigned char)s2[m]:next2);
+	}
+
+/** compare two targets as strcmp would compare their full names */
+static int TargetNameCmp(const Target* a,const Target* b)
+	{
+	DirNodePtr da=a->dir,db=b->dir;
+	/* number of directories above the leaves */
+	size_t ha=(da==NULL?0:da->depth+1);
+	size_t hb=(db==NULL?0:db->depth+1);
+	if(da==db) return strcmp(a->leaf,b->leaf);
+	if(ha>hb)
+		{
+		/* the directory of 'a' at the depth of the leaf of 'b' */
+		while(da->depth > hb) da=da->parent;
+		if(da->parent==db) return ComponentCmp(da->component,da->length,'/',b->leaf,strlen(b->leaf),0);
+		da=da->parent;
+		}
+	else if(hb>ha)
+		{
+		while(db->depth > ha) db=db->parent;
+		if(db->parent==da) return ComponentCmp(a->leaf,strlen(a->leaf),0,db->component,db->length,'/');
+		db=db->parent;
+		}
+	/* two different directories at the same depth */
+	while(da->parent!=db->parent)
+		{
+		da=da->parent;
+		db=db->parent;
+		}
+	return ComponentCmp(da->component,da->length,'/',db->component,db->length,'/');
+	}
+
+/** compare target by name */
+static int TargetCmp(const void * a, const void * b)
+	{
+	return TargetNameCmp(*(TargetPtr*)a,*(TargetPtr*)b);
+	}
+
+/** creates a new target */
+static TargetPtr TargetNew(GraphPtr graph,DirNodePtr dir,const char* leaf)
+	{
+	TargetPtr target=(TargetPtr)calloc(1,sizeof(Target));
+	if(target==NULL) OUT_OF_MEMORY;
+	target->id=(++graph->id_generator);
+	target->dir=dir;
+	target->leaf=leaf;
+	target->level=0;
+	return target;
+	}
+
+/** release a target */
+static void TargetFree(TargetPtr t)
+	{
+	if(t==NULL) return;
+	free(t->children);
+	free(t);
+	}
+
+/** add a children to the specified target */
+static void TargetAddChildren(TargetPtr root, TargetPtr c)
+	{
+	/* binary search of the insertion point, the children stay sorted */
+	size_t lo=0UL,hi=root->n_children;
+	while(lo<hi)
+		{
+		size_t mid=(lo+hi)/2;
+		int r=TargetNameCmp(root->children[mid],c);
+		if(r==0) return;
+		if(r<0) lo=mid+1;
+		else hi=mid;
+		}
+	if((root->n_children & (root->n_children-1))==0)
+		{
+		/* grow when the count is a power of two */
+		root->children=realloc(root->children,sizeof(TargetPtr)*(root->n_children==0?1:root->n_children*2));
+		if(root->children==NULL)  OUT_OF_MEMORY;
+		}
+	memmove(&root->children[lo+1],&root->children[lo],sizeof(TargetPtr)*(root->n_children-lo));
+	root->children[lo]=c;
+	root->n_children++;
+	c->level=root->level+1;
+	}
+
+/** does string starts with substring */
+static int startsWith(const char* str,const char* pre)
+	{
+    	size_t lenpre = strlen(pre), lenstr = strlen(str);
+   	return lenstr < lenpre ? 0 : strncmp(pre, str, lenpre) == 0;
+  }
+
+static int endsWith(const char *str, const char *suffix)
+{
+  if (!str || !suffix)
+    return 0;
+  size_t lenstr = strlen(str);
+  size_t lensuffix = strlen(suffix);
+  if (lensuffix >  lenstr)
+    return 0;
+  return strncmp(str + lenstr - lensuffix, suffix, lensuffix) == 0;
+}
+
+/** set the last error of the graph, always returns -1 */
+static int GraphSetError(GraphPtr g,const char* fmt,...)
+	{
+	va_list ap;
+	int n;
+	va_start(ap,fmt);
+	n=vsnprintf(NULL,0,fmt,ap);
+	va_end(ap);
+	free(g->error);
+	g->error=(char*)malloc(n+1);
+	if(g->error==NULL) OUT_OF_MEMORY;
+	va_start(ap,fmt);
+	vsnprintf(g->error,n+1,fmt,ap);
+	va_end(ap);
+	return -1;
+	}
+
+/** seconds elapsed since an arbitrary point in the past */
+static double MonotonicTime(void)
+	{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec + ts.tv_nsec/1.0E9;
+	}
+
+/** a parser budget was reached, the output is marked as truncated. if 'stop' the remaining lines are ignored */
+static void GraphTruncate(GraphPtr g,const char* reason,int stop)
+	{
+	if(g->truncated==NULL) g->truncated=reason;
+	if(stop) g->done=1;
+	}
+
+/** extract filename between '`' and "'"
+ * Make v4.0 changed this: the first separator is now "'"
+ * returns NULL and sets the error of the graph if there is no name.
+ */
+static char* targetName(GraphPtr g,const char* line)
+	{
+	char* p;
+	char* b=strchr(line,'`');
+	if(b==NULL) b=strchr(line,'\'');//GNU make 4.0
+      	char* e=( b==NULL ? NULL : strchr(b+1,'\'') );
+      	if(b==NULL  || e==NULL || b>e)
+      		{
+      		GraphSetError(g,"Cannot get target name in \"%s\".",line);
+      		return NULL;
+      		}
+        p= StrNDup(b+1,(e-b)-1);
+	if(p==NULL) OUT_OF_MEMORY;
+	return p;
+	}
+
+/** slot of the target 'leaf' in 'dir' in the hash table: its slot or the empty slot where it would be inserted */
+static size_t GraphTargetSlot(const Graph* g,const DirNode* dir,const char* leaf,size_t len)
+	{
+	size_t mask=g->target_slot_count-1;
+	size_t i=NameHash(dir,leaf,len)&mask;
+	for(;;)
+		{
+		uint32_t s=g->target_slots[i];
+		TargetPtr t;
+		if(s==0) return i;
+		t=g->targets[s-1];
+		if(t->dir==dir && strncmp(t->leaf,leaf,len)==0 && t->leaf[len]==0) return i;
+		i=(i+1)&mask;
+		}
+	}
+
+/** find the target 'leaf' in 'dir', NULL if it doesn't exist */
+static TargetPtr GraphTargetFind(const Graph* g,const DirNode* dir,const char* leaf,size_t len)
+	{
+	uint32_t s;
+	if(g->target_slot_count==0) return NULL;
+	s=g->target_slots[GraphTargetSlot(g,dir,leaf,len)];
+	return s==0?NULL:g->targets[s-1];
+	}
+
+/** (re)build the hash table of the targets with 'count' slots, a power of 2 */
+static void GraphIndexTargets(GraphPtr g,size_t count)
+	{
+	size_t i;
+	free(g->target_slots);
+	g->target_slots=(uint32_t*)calloc(count,sizeof(uint32_t));
+	if(g->target_slots==NULL) OUT_OF_MEMORY;
+	g->target_slot_count=count;
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		t->index=i;
+		g->target_slots[GraphTargetSlot(g,t->dir,t->leaf,strlen(t->leaf))]=(uint32_t)(i+1);
+		}
+	}
+
+/** forget the cached reverse edges, the targets or the edges changed */
+static void GraphDropParents(GraphPtr g)
+	{
+	free(g->parents);
+	free(g->parent_offsets);
+	g->parents=NULL;
+	g->parent_offsets=NULL;
+	}
+
+/** add an edge between two targets of the graph */
+static void GraphAddChild(GraphPtr g,TargetPtr root,TargetPtr c)
+	{
+	GraphDropParents(g);
+	TargetAddChildren(root,c);
+	}
+
+/** sort the targets by name, if needed */
+static void GraphSortTargets(GraphPtr graph)
+	{
+	if(graph->sorted) return;
+	GraphDropParents(graph);
+	qsort(graph->targets, graph->target_count ,sizeof(TargetPtr) , TargetCmp);
+	GraphIndexTargets(graph,graph->target_slot_count);
+	graph->sorted=1;
+	}
+
+/** find the target 'leaf' in 'dir', create it if 'create' is true */
+static TargetPtr GraphTarget(GraphPtr graph,DirNodePtr dir,const char* leaf,size_t len,int create)
+	{
+	TargetPtr t=GraphTargetFind(graph,dir,leaf,len);
+	size_t i;
+	if(t!=NULL || !create) return t;
+	if(graph->target_count>=UINT32_MAX-1) OUT_OF_MEMORY;
+	if((graph->target_count+1)*4 > graph->target_slot_count*3)
+		{
+		GraphIndexTargets(graph,graph->target_slot_count==0?1024:graph->target_slot_count*2);
+		}
+	i=GraphTargetSlot(graph,dir,leaf,len);
+
+	t=TargetNew(graph,dir,PoolStrNDup(graph,leaf,len));
+	if((graph->target_count & (graph->target_count-1))==0)
+		{
+		/* grow when the count is a power of two */
+		graph->targets = (TargetPtr*)realloc(
+			(void*)graph->targets,
+			sizeof(TargetPtr)*(graph->target_count==0?1:graph->target_count*2)
+			);
+		if(graph->targets==NULL) OUT_OF_MEMORY;
+		}
+	GraphDropParents(graph);
+	t->index=graph->target_count;
+	graph->targets[ graph->target_count ] = t;
+	graph->target_count++;
+	graph->target_slots[i]=(uint32_t)graph->target_count;
+	graph->sorted=0;
+
+	return t;
+	}
+
+
+/** find the target of 'graph' having the same name as the target 't' of another graph, create it if 'create' is true */
+static TargetPtr GraphTargetLike(GraphPtr graph,const Target* t,int create)
+	{
+	DirNodePtr dir=GraphDirCopy(graph,t->dir,create);
+	if(t->dir!=NULL && dir==NULL) return NULL;
+	return GraphTarget(graph,dir,t->leaf,strlen(t->leaf),create);
+	}
+
+/** find a target by name */
+static TargetPtr GraphSearchTarget(const Graph* graph,const char* name)
+	{
+	const char* slash=strrchr(name,'/');
+	DirNodePtr dir=NULL;
+	if(slash!=NULL)
+		{
+		dir=GraphDirFind(graph,name,(size_t)(slash-name));
+		if(dir==NULL) return NULL;
+		name=slash+1;
+		}
+	return GraphTargetFind(graph,dir,name,strlen(name));
+	}
+
+ /** get target, create it it doesn't exist */
+static TargetPtr GraphGetTarget(GraphPtr graph,const char* name)
+	{
+	const char* slash=strrchr(name,'/');
+	DirNodePtr dir=NULL;
+	if(slash!=NULL)
+		{
+		dir=GraphDir(graph,name,(size_t)(slash-name));
+		name=slash+1;
+		}
+	return GraphTarget(graph,dir,name,strlen(name),1);
+	}
+
+/** get a target while parsing. if it doesn't exist, it is created only if 'create'
+ * and if the node budget is not exhausted. returns NULL if there is no target */
+static TargetPtr GraphScanTarget(GraphPtr g,const char* name,int create)
+	{
+	TargetPtr t=GraphSearchTarget(g,name);
+	if(t!=NULL || !create) return t;
+	/* the <ROOT> target is not counted */
+	if(g->max_nodes>0 && g->target_count > g->max_nodes)
+		{
+		GraphTruncate(g,"node budget reached",1);
+		return NULL;
+		}
+	return GraphGetTarget(g,name);
+	}
+
+/** push a new frame on the parser stack */
+static void GraphPushFrame(GraphPtr g,TargetPtr root,size_t level)
+	{
+	ScanFramePtr f;
+	if(g->frame_count==g->frame_capacity)
+		{
+		g->frame_capacity=(g->frame_capacity==0?16:g->frame_capacity*2);
+		g->frames=(ScanFramePtr)realloc(g->frames,sizeof(ScanFrame)*g->frame_capacity);
+		if(g->frames==NULL) OUT_OF_MEMORY;
+		}
+	f=&g->frames[g->frame_count++];
+	f->root=root;
+	f->level=level;
+	f->makefile_name=NULL;
+	}
+
+/** pop the top frame of the parser stack */
+static void GraphPopFrame(GraphPtr g)
+	{
+	assert(g->frame_count>0);
+	g->frame_count--;
+	free(g->frames[g->frame_count].makefile_name);
+	if(g->frame_count==0) g->done=1;
+	}
+
+/** remember a makefile read by make */
+static void GraphAddMakefile(GraphPtr g,const char* name)
+	{
+	size_t i;
+	for(i=0;i< g->makefile_count;++i)
+		{
+		if(strcmp(g->makefiles[i],name)==0) return;
+		}
+	g->makefiles=(char**)realloc(g->makefiles,sizeof(char*)*(g->makefile_count+1));
+	if(g->makefiles==NULL) OUT_OF_MEMORY;
+	g->makefiles[g->makefile_count++]=StrDupOrNull(name);
+	}
+
+/** is this line the end of the prerequisites of a target */
+static int isFinishedLine(const char* line)
+	{
+	return startsWith(line,"Finished prerequisites of target file ") || endsWith(line, "was considered already.");
+	}
+
+/** scan one line of the makefile -nd output, 'iLevel' is the number of leading spaces */
+static int GraphScanLine(GraphPtr graph,const char* line,size_t iLevel)
+	{
+	ScanFramePtr frame;
+	if(graph->done) return 0;
+	frame=&graph->frames[graph->frame_count-1];
+
+	/* skip lines until the makefile of this frame is finished */
+	if(graph->skip_makefile)
+		{
+		if(isFinishedLine(line))
+			{
+			char* tName=targetName(graph,line);
+			if(tName==NULL) return -1;
+			if(strcmp(tName,frame->makefile_name)==0)
+				{
+				graph->skip_makefile=0;
+				}
+			free(tName);
+			}
+		return 0;
+		}
+
+	/* skip the targets deeper than max_depth, only the nesting is tracked */
+	if(graph->skip_depth>0)
+		{
+		if(startsWith(line,"Considering target file"))
+			{
+			graph->skip_depth++;
+			}
+		else if(isFinishedLine(line))
+			{
+			graph->skip_depth--;
+			}
+		return 0;
+		}
+
+	if(startsWith(line,"Considering target file"))
+		{
+		char* tName=targetName(graph,line);
+		if(tName==NULL) return -1;
+		if(!graph->show_root &&
+		   frame->makefile_name!=NULL &&
+		   strcmp(tName,frame->makefile_name)==0)
+			{
+			free(tName);
+			graph->skip_makefile=1;
+			return 0;
+			}
+		/* the frames below the <ROOT> frame are the depth of the new target */
+		if(graph->max_depth>0 && graph->frame_count > graph->max_depth)
+			{
+			free(tName);
+			graph->skip_depth=1;
+			GraphTruncate(graph,"depth budget reached",0);
+			return 0;
+			}
+
+		TargetPtr child=GraphScanTarget(graph,tName,1);
+		free(tName);
+		if(child==NULL) return 0;
+
+		if(frame->level+1 >= iLevel)
+			{
+			GraphAddChild(graph,frame->root,child);
+			GraphPushFrame(graph,child,iLevel+1);
+			}
+		}
+	else if(startsWith(line,"Must remake target "))
+		{
+		char* tName=targetName(graph,line);
+		TargetPtr t;
+		if(tName==NULL) return -1;
+		/* don't create the targets that were skipped */
+		t=GraphScanTarget(graph,tName,graph->truncated==NULL);
+		if(t!=NULL) t->must_remake=1;
+		free(tName);
+		}
+	else if(startsWith(line,"Pruning file "))
+		{
+		char* tName=targetName(graph,line);
+		TargetPtr t;
+		if(tName==NULL) return -1;
+		t=GraphScanTarget(graph,tName,graph->max_depth==0 || graph->frame_count <= graph->max_depth);
+		if(t!=NULL) GraphAddChild(graph,frame->root,t);
+		free(tName);
+		}
+	else if( isFinishedLine(line) && (frame->level+1 >= iLevel))
+		{
+		char* tName=targetName(graph,line);
+		if(tName==NULL) return -1;
+		if(!TargetNameEquals(frame->root,tName))
+			{
+			char* expect=TargetPathDup(frame->root);
+			GraphSetError(graph,"expected %s got %s", expect , line);
+			free(expect);
+			free(tName);
+			return -1;
+			}
+		free(tName);
+		GraphPopFrame(graph);
+		}
+	else if(startsWith(line,"Reading makefile "))
+		{
+		char* tName=targetName(graph,line);
+		if(tName==NULL) return -1;
+		free(frame->makefile_name);
+		frame->makefile_name=tName;
+		GraphAddMakefile(graph,tName);
+		}
+	return 0;
+	}
+
+/** parse the pending line and reset it */
+static int GraphFlushLine(GraphPtr g)
+	{
+	int ret;
+	/* reading the clock at each line would be too slow */
+	if(g->deadline>0 && (++g->line_count % 1024)==0 && MonotonicTime() > g->deadline)
+		{
+		GraphTruncate(g,"timeout reached",1);
+		}
+	if(g->line_capacity==0)
+		{
+		g->line_capacity=BUFSIZ;
+		g->line=(char*)malloc(g->line_capacity);
+		if(g->line==NULL) OUT_OF_MEMORY;
+		}
+	g->line[g->line_len]=0;
+	ret=GraphScanLine(g,g->line,g->line_level);
+	g->line_len=0UL;
+	g->line_level=0UL;
+	return ret;
+	}
+
+int GraphFeed(GraphPtr g,const char* bytes,size_t len)
+	{
+	size_t i=0;
+	if(g->error!=NULL) return -1;
+	while(i<len && !g->done)
+		{
+		const char* eol=(const char*)memchr(bytes+i,'\n',len-i);
+		size_t end=(eol==NULL?len:(size_t)(eol-bytes));
+		/* trim on the fly */
+		while(g->line_len==0 && i<end && isspace((unsigned char)bytes[i]))
+			{
+			g->line_level++;
+			i++;
+			}
+		if(i<end)
+			{
+			size_t n=end-i;
+			if(g->line_len+n+1 > g->line_capacity)
+				{
+				while(g->line_len+n+1 > g->line_capacity)
+					{
+					g->line_capacity=(g->line_capacity==0?BUFSIZ:g->line_capacity*2);
+					}
+				g->line=(char*)realloc(g->line,g->line_capacity);
+				if(g->line==NULL) OUT_OF_MEMORY;
+				}
+			memcpy(&g->line[g->line_len],bytes+i,n);
+			g->line_len+=n;
+			i=end;
+			}
+		if(eol!=NULL)
+			{
+			if(GraphFlushLine(g)!=0) return -1;
+			i++;
+			}
+		}
+	return 0;
+	}
+
+int GraphFeedEnd(GraphPtr g)
+	{
+	if(g->error!=NULL) return -1;
+	if((g->line_len>0 || g->line_level>0) && GraphFlushLine(g)!=0) return -1;
+	/* sorted once for all, the accessors don't modify the graph */
+	GraphSortTargets(g);
+	return 0;
+	}
+
+int GraphScanFile(GraphPtr g,FILE* in)
+	{
+	char buf[BUFSIZ];
+	size_t n;
+	while((n=fread(buf,sizeof(char),BUFSIZ,in))>0)
+		{
+		if(GraphFeed(g,buf,n)!=0) return -1;
+		}
+	if(ferror(in))
+		{
+		return GraphSetError(g,"Cannot read input.");
+		}
+	return GraphFeedEnd(g);
+	}
+
+void GraphOptionsInit(GraphOptionsPtr opts)
+	{
+	memset((void*)opts,0,sizeof(GraphOptions));
+	opts->struct_size=sizeof(GraphOptions);
+	}
+
+/** true if the caller of GraphNew knows 'field', i.e. it is within opts->struct_size */
+#define OPTION_GIVEN(opts,field) (offsetof(GraphOptions,field)+sizeof((opts)->field) <= (opts)->struct_size)
+
+GraphPtr GraphNew(const GraphOptions* opts)
+	{
+	GraphPtr g;
+	if(opts!=NULL && opts->struct_size< offsetof(GraphOptions,print_basename_only)+sizeof(int)) return NULL;
+	g=(GraphPtr)calloc(1,sizeof(Graph));
+	if(g==NULL) OUT_OF_MEMORY;
+	if(opts!=NULL)
+		{
+		g->print_basename_only = opts->print_basename_only;
+		if(OPTION_GIVEN(opts,print_suffix_only)) g->print_suffix_only = opts->print_suffix_only;
+		if(OPTION_GIVEN(opts,show_root)) g->show_root = opts->show_root;
+		if(OPTION_GIVEN(opts,colorscheme)) g->colorscheme = StrDupOrNull(opts->colorscheme);
+		if(OPTION_GIVEN(opts,graph_attributes)) g->graph_attributes = StrDupOrNull(opts->graph_attributes);
+		if(OPTION_GIVEN(opts,node_attributes)) g->node_attributes = StrDupOrNull(opts->node_attributes);
+		if(OPTION_GIVEN(opts,edge_attributes)) g->edge_attributes = StrDupOrNull(opts->edge_attributes);
+		if(OPTION_GIVEN(opts,dirty_attributes)) g->dirty_attributes = StrDupOrNull(opts->dirty_attributes);
+		if(OPTION_GIVEN(opts,threads)) g->threads = (opts->threads > MAX_RENDER_THREADS ? MAX_RENDER_THREADS : opts->threads);
+		if(OPTION_GIVEN(opts,max_nodes)) g->max_nodes = opts->max_nodes;
+		if(OPTION_GIVEN(opts,max_depth)) g->max_depth = opts->max_depth;
+		if(OPTION_GIVEN(opts,timeout) && opts->timeout>0) g->deadline = MonotonicTime() + opts->timeout;
+		}
+	g->root=GraphGetTarget(g,"<ROOT>");
+	GraphPushFrame(g,g->root,0);
+	return g;
+	}
+
+void GraphFree(GraphPtr g)
+	{
+	size_t i;
+	if(g==NULL) return;
+	for(i=0;i< g->target_count;++i) TargetFree(g->targets[i]);
+	free(g->targets);
+	free(g->target_slots);
+	free(g->dir_buckets);
+	GraphDropParents(g);
+	while(g->pool!=NULL)
+		{
+		PoolBlockPtr next=g->pool->next;
+		free(g->pool);
+		g->pool=next;
+		}
+	for(i=0;i< g->makefile_count;++i) free(g->makefiles[i]);
+	free(g->makefiles);
+	while(g->frame_count>0) GraphPopFrame(g);
+	free(g->frames);
+	free(g->line);
+	free(g->colorscheme);
+	free(g->graph_attributes);
+	free(g->node_attributes);
+	free(g->edge_attributes);
+	free(g->dirty_attributes);
+	free(g->error);
+	free(g);
+	}
+
+const char* GraphError(const Graph* g)
+	{
+	return g->error;
+	}
+
+const char* GraphTruncated(const Graph* g)
+	{
+	return g->truncated;
+	}
+
+int GraphFeedDone(const Graph* g)
+	{
+	return g->done;
+	}
+
+double GraphTimeLeft(GraphPtr g)
+	{
+	double left;
+	if(g->deadline<=0) return -1;
+	left=g->deadline-MonotonicTime();
+	if(left>0) return left;
+	GraphTruncate(g,"timeout reached",1);
+	return 0;
+	}
+
+size_t GraphTargetCount(const Graph* g)
+	{
+	return g->target_count;
+	}
+
+TargetPtr GraphTargetAt(const Graph* g,size_t i)
+	{
+	assert(i < g->target_count);
+	return g->targets[i];
+	}
+
+TargetPtr GraphRoot(const Graph* g)
+	{
+	return g->root;
+	}
+
+TargetPtr GraphFindTarget(const Graph* g,const char* name)
+	{
+	return GraphSearchTarget(g,name);
+	}
+
+size_t GraphMakefileCount(const Graph* g)
+	{
+	return g->makefile_count;
+	}
+
+const char* GraphMakefileAt(const Graph* g,size_t i)
+	{
+	assert(i < g->makefile_count);
+	return g->makefiles[i];
+	}
+
+/** build the reverse edges if they are not cached, the targets must be sorted */
+static void GraphParents(GraphPtr g)
+	{
+	size_t i,j,n=0UL;
+	size_t* offsets;
+	if(g->parents!=NULL) return;
+	offsets=(size_t*)calloc(g->target_count+1,sizeof(size_t));
+	if(offsets==NULL) OUT_OF_MEMORY;
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr p= g->targets[i];
+		n+=p->n_children;
+		for(j=0;j< p->n_children;++j) offsets[p->children[j]->index+1]++;
+		}
+	for(i=0;i< g->target_count;++i) offsets[i+1]+=offsets[i];
+	g->parents=(TargetPtr*)malloc(sizeof(TargetPtr)*(n+1));
+	if(g->parents==NULL) OUT_OF_MEMORY;
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr p= g->targets[i];
+		for(j=0;j< p->n_children;++j)
+			{
+			size_t c=p->children[j]->index;
+			g->parents[offsets[c]++]=p;
+			}
+		}
+	/* offsets[c] is now the end of the parents of c, shift them back */
+	for(i=g->target_count;i>0;--i) offsets[i]=offsets[i-1];
+	offsets[0]=0UL;
+	g->parent_offsets=offsets;
+	}
+
+size_t GraphInvalidateTargets(GraphPtr g,TargetPtr* targets,size_t count)
+	{
+	size_t i,j,n=0UL,changed=0UL;
+	TargetPtr* stack;
+	char* seen;
+	GraphSortTargets(g);
+	GraphParents(g);
+	stack=(TargetPtr*)malloc(sizeof(TargetPtr)*(g->target_count+1));
+	seen=(char*)calloc(g->target_count,sizeof(char));
+	if(stack==NULL || seen==NULL) OUT_OF_MEMORY;
+	for(i=0;i< count;++i)
+		{
+		if(seen[targets[i]->index]) continue;
+		seen[targets[i]->index]=1;
+		stack[n++]=targets[i];
+		}
+	while(n>0)
+		{
+		TargetPtr c=stack[--n];
+		for(j=g->parent_offsets[c->index];j< g->parent_offsets[c->index+1];++j)
+			{
+			TargetPtr p=g->parents[j];
+			if(seen[p->index]) continue;
+			seen[p->index]=1;
+			if(!p->must_remake && p!=g->root)
+				{
+				p->must_remake=1;
+				changed++;
+				}
+			stack[n++]=p;
+			}
+		}
+	free(seen);
+	free(stack);
+	return changed;
+	}
+
+size_t GraphInvalidate(GraphPtr g,TargetPtr t)
+	{
+	return GraphInvalidateTargets(g,&t,1UL);
+	}
+
+/** a new empty graph with the same options, ids and truncation as 'g', it won't parse anything */
+static GraphPtr GraphNewLike(const Graph* g)
+	{
+	GraphOptions opts;
+	GraphPtr sub;
+	GraphOptionsInit(&opts);
+	opts.print_basename_only=g->print_basename_only;
+	opts.print_suffix_only=g->print_suffix_only;
+	opts.show_root=g->show_root;
+	opts.colorscheme=g->colorscheme;
+	opts.graph_attributes=g->graph_attributes;
+	opts.node_attributes=g->node_attributes;
+	opts.edge_attributes=g->edge_attributes;
+	opts.dirty_attributes=g->dirty_attributes;
+	opts.threads=g->threads;
+	sub=GraphNew(&opts);
+	sub->root->id=g->root->id;
+	sub->id_generator=g->id_generator;
+	sub->done=1;
+	sub->truncated=g->truncated;
+	return sub;
+	}
+
+GraphPtr GraphFocus(const Graph* g,const Target* t)
+	{
+	GraphPtr sub=GraphNewLike(g);
+	const Target** stack;
+	size_t i,j,n=0UL;
+	char* seen;
+
+	stack=(const Target**)malloc(sizeof(TargetPtr)*(g->target_count+1));
+	seen=(char*)calloc(g->target_count,sizeof(char));
+	if(stack==NULL || seen==NULL) OUT_OF_MEMORY;
+
+	/* the <ROOT> of 'g' is the <ROOT> of the new graph, it only brings its children */
+	if(t!=g->root) GraphAddChild(sub,sub->root,GraphTargetLike(sub,t,1));
+	stack[n++]=t;
+	seen[t->index]=1;
+	while(n>0)
+		{
+		const Target* c=stack[--n];
+		TargetPtr copy=GraphTargetLike(sub,c,0);
+		for(j=0;j< c->n_children;++j)
+			{
+			TargetPtr cc=c->children[j];
+			GraphAddChild(sub,copy,GraphTargetLike(sub,cc,1));
+			if(seen[cc->index]) continue;
+			seen[cc->index]=1;
+			stack[n++]=cc;
+			}
+		}
+	/* restore the original ids, levels and flags */
+	for(i=0;i< g->target_count;++i)
+		{
+		const Target* src=g->targets[i];
+		TargetPtr copy;
+		if(!seen[i] || src==g->root) continue;
+		copy=GraphTargetLike(sub,src,0);
+		copy->id=src->id;
+		copy->level=src->level;
+		copy->must_remake=src->must_remake;
+		}
+	free(seen);
+	free(stack);
+	GraphSortTargets(sub);
+	return sub;
+	}
+
+/** component of the targets not visited yet by GraphComponents */
+#define NO_COMPONENT ((size_t)-1)
+
+/** strongly connected components (Tarjan), iterative so that deep graphs don't overflow the stack.
+ * sets t->component. The components are numbered in reverse topological order:
+ * the prerequisites of a target are in its own component or in a component with a lower number.
+ * returns the number of components */
+static size_t GraphComponents(GraphPtr g)
+	{
+	size_t i,n=g->target_count,counter=0UL,count=0UL,sp=0UL,cp=0UL;
+	size_t* order;
+	size_t* low;
+	size_t* next;
+	TargetPtr* stack;
+	TargetPtr* calls;
+	GraphSortTargets(g);
+	order=(size_t*)calloc(n+1,sizeof(size_t));
+	low=(size_t*)malloc(sizeof(size_t)*(n+1));
+	next=(size_t*)malloc(sizeof(size_t)*(n+1));
+	stack=(TargetPtr*)malloc(sizeof(TargetPtr)*(n+1));
+	calls=(TargetPtr*)malloc(sizeof(TargetPtr)*(n+1));
+	if(order==NULL || low==NULL || next==NULL || stack==NULL || calls==NULL) OUT_OF_MEMORY;
+	for(i=0;i< n;++i)
+		{
+		g->targets[i]->component=NO_COMPONENT;
+		}
+	for(i=0;i< n;++i)
+		{
+		/* order is 0 for the targets that were not visited */
+		if(order[i]!=0) continue;
+		order[i]=low[i]=(++counter);
+		next[i]=0UL;
+		stack[sp++]=g->targets[i];
+		calls[cp++]=g->targets[i];
+		while(cp>0)
+			{
+			TargetPtr v=calls[cp-1];
+			size_t vi=v->index;
+			if(next[vi] < v->n_children)
+				{
+				TargetPtr w=v->children[next[vi]++];
+				size_t wi=w->index;
+				if(order[wi]==0)
+					{
+					order[wi]=low[wi]=(++counter);
+					next[wi]=0UL;
+					stack[sp++]=w;
+					calls[cp++]=w;
+					}
+				else if(w->component==NO_COMPONENT && order[wi]<low[vi])
+					{
+					/* w is still on the stack */
+					low[vi]=order[wi];
+					}
+				continue;
+				}
+			cp--;
+			if(cp>0 && low[vi] < low[calls[cp-1]->index])
+				{
+				low[calls[cp-1]->index]=low[vi];
+				}
+			if(low[vi]==order[vi])
+				{
+				TargetPtr w;
+				do	{
+					w=stack[--sp];
+					w->component=count;
+					} while(w!=v);
+				count++;
+				}
+			}
+		}
+	free(calls);
+	free(stack);
+	free(next);
+	free(low);
+	free(order);
+	return count;
+	}
+
+/** group the targets by component, must be called after GraphComponents.
+ * the targets of component k are targets[members[offsets[k]..offsets[k+1]-1]], sorted by name */
+static size_t* GraphComponentMembers(GraphPtr g,size_t count,size_t** offsets_out)
+	{
+	size_t i;
+	size_t* offsets=(size_t*)calloc(count+1,sizeof(size_t));
+	size_t* members=(size_t*)malloc(sizeof(size_t)*(g->target_count+1));
+	if(offsets==NULL || members==NULL) OUT_OF_MEMORY;
+	for(i=0;i< g->target_count;++i) offsets[g->targets[i]->component+1]++;
+	for(i=0;i< count;++i) offsets[i+1]+=offsets[i];
+	for(i=0;i< g->target_count;++i) members[offsets[g->targets[i]->component]++]=i;
+	/* offsets[k] is now the end of component k, shift them back */
+	for(i=count;i>0;--i) offsets[i]=offsets[i-1];
+	offsets[0]=0UL;
+	*offsets_out=offsets;
+	return members;
+	}
+
+/** does the target depend on itself */
+static int TargetHasSelfEdge(const Target* t)
+	{
+	size_t j;
+	for(j=0;j< t->n_children;++j)
+		{
+		if(t->children[j]==t) return 1;
+		}
+	return 0;
+	}
+
+/** flags the targets reachable from <ROOT>, the targets must be sorted */
+static char* GraphReachable(GraphPtr g)
+	{
+	size_t j,n=0UL;
+	TargetPtr* stack=(TargetPtr*)malloc(sizeof(TargetPtr)*(g->target_count+1));
+	char* seen=(char*)calloc(g->target_count,sizeof(char));
+	if(stack==NULL || seen==NULL) OUT_OF_MEMORY;
+	stack[n++]=g->root;
+	seen[g->root->index]=1;
+	while(n>0)
+		{
+		TargetPtr c=stack[--n];
+		for(j=0;j< c->n_children;++j)
+			{
+			TargetPtr cc=c->children[j];
+			if(seen[cc->index]) continue;
+			seen[cc->index]=1;
+			stack[n++]=cc;
+			}
+		}
+	free(stack);
+	return seen;
+	}
+
+void GraphAnalysisInit(GraphAnalysisPtr a)
+	{
+	memset((void*)a,0,sizeof(GraphAnalysis));
+	a->struct_size=sizeof(GraphAnalysis);
+	}
+
+int GraphAnalyze(GraphPtr g,GraphAnalysisPtr a)
+	{
+	GraphAnalysis r;
+	size_t i,count,size;
+	size_t* offsets;
+	size_t* members;
+	char* seen;
+	if(a->struct_size< offsetof(GraphAnalysis,component_count)+sizeof(size_t)) return -1;
+	count=GraphComponents(g);
+	members=GraphComponentMembers(g,count,&offsets);
+	seen=GraphReachable(g);
+	GraphAnalysisInit(&r);
+	r.component_count=count;
+	for(i=0;i< count;++i)
+		{
+		if(offsets[i+1]-offsets[i]>1) r.cycle_count++;
+		}
+	for(i=0;i< g->target_count;++i)
+		{
+		if(TargetHasSelfEdge(g->targets[i])) r.self_edge_count++;
+		if(!seen[i]) r.unreachable_count++;
+		}
+	free(seen);
+	free(members);
+	free(offsets);
+	/* a caller built against an older make2graph.h only knows the first fields */
+	size=(a->struct_size< sizeof(GraphAnalysis)?a->struct_size:sizeof(GraphAnalysis));
+	memcpy((char*)a+sizeof(size_t),(const char*)&r+sizeof(size_t),size-sizeof(size_t));
+	return 0;
+	}
+
+GraphPtr GraphCondense(GraphPtr g)
+	{
+	GraphPtr sub=GraphNewLike(g);
+	size_t i,j,k,count=GraphComponents(g);
+	size_t* offsets;
+	size_t* members=GraphComponentMembers(g,count,&offsets);
+	TargetPtr* copies=(TargetPtr*)malloc(sizeof(TargetPtr)*(count+1));
+	if(copies==NULL) OUT_OF_MEMORY;
+
+	/* one target per component, named after its first member */
+	for(k=0;k< count;++k)
+		{
+		size_t size=offsets[k+1]-offsets[k];
+		TargetPtr first=g->targets[members[offsets[k]]];
+		TargetPtr copy;
+		if(size==1)
+			{
+			copy=GraphTargetLike(sub,first,1);
+			}
+		else
+			{
+			size_t len=TargetPathLength(first);
+			char* name=(char*)malloc(len+32);
+			if(name==NULL) OUT_OF_MEMORY;
+			TargetPathCopy(first,name);
+			sprintf(name+len," (+%lu)",(unsigned long)(size-1));
+			copy=GraphGetTarget(sub,name);
+			free(name);
+			}
+		copies[k]=copy;
+		}
+	/* the edges between the components */
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		for(j=0;j< t->n_children;++j)
+			{
+			TargetPtr c=t->children[j];
+			if(c->component==t->component) continue;
+			GraphAddChild(sub,copies[t->component],copies[c->component]);
+			}
+		}
+	/* restore the original ids, levels and flags */
+	for(k=0;k< count;++k)
+		{
+		TargetPtr copy=copies[k];
+		TargetPtr first=g->targets[members[offsets[k]]];
+		copy->id=first->id;
+		copy->level=first->level;
+		copy->must_remake=0;
+		for(i=offsets[k];i< offsets[k+1];++i)
+			{
+			TargetPtr t=g->targets[members[i]];
+			if(t->level < copy->level) copy->level=t->level;
+			if(t->must_remake) copy->must_remake=1;
+			}
+		}
+	free(copies);
+	free(members);
+	free(offsets);
+	GraphSortTargets(sub);
+	return sub;
+	}
+
+size_t TargetId(const Target* t)
+	{
+	return t->id;
+	}
+
+size_t TargetName(const Target* t,char* buf,size_t size)
+	{
+	size_t len=TargetPathLength(t);
+	if(len< size)
+		{
+		TargetPathCopy(t,buf);
+		}
+	else if(size>0)
+		{
+		char* p=TargetPathDup(t);
+		memcpy(buf,p,size-1);
+		buf[size-1]=0;
+		free(p);
+		}
+	return len;
+	}
+
+int TargetMustRemake(const Target* t)
+	{
+	return t->must_remake;
+	}
+
+size_t TargetLevel(const Target* t)
+	{
+	return t->level;
+	}
+
+size_t TargetChildCount(const Target* t)
+	{
+	return t->n_children;
+	}
+
+TargetPtr TargetChildAt(const Target* t,size_t i)
+	{
+	assert(i < t->n_children);
+	return t->children[i];
+	}
+
+int GraphSinkFileWrite(void* ctx,const char* data,size_t len)
+	{
+	return fwrite(data,sizeof(char),len,(FILE*)ctx)==len ? 0 : -1;
+	}
+
+int GraphSinkFdWrite(void* ctx,const char* data,size_t len)
+	{
+	int fd=*((int*)ctx);
+	while(len>0)
+		{
+		ssize_t n=write(fd,data,len);
+		if(n<0)
+			{
+			if(errno==EINTR) continue;
+			return -1;
+			}
+		data+=n;
+		len-=(size_t)n;
+		}
+	return 0;
+	}
+
+/** size of the buffer of a Writer on a sink */
+#define WRITER_BUFFER_SIZE (1<<18)
+/** initial size of the buffer of a Writer in memory */
+#define WRITER_MEMORY_SIZE (1<<16)
+
+/** a buffered writer on top of a sink, used by all the DumpGraphAs* functions.
+ * Without a sink, the buffer grows and keeps the whole output in memory. */
+typedef struct writer_t
+	{
+	/** destination or NULL */
+	GraphSinkPtr sink;
+	/** pending bytes */
+	char* buffer;
+	/** number of pending bytes */
+	size_t len;
+	/** allocated size of buffer */
+	size_t capacity;
+	/** 0 or -1 if the sink failed */
+	int error;
+	}Writer,*WriterPtr;
+
+static void WriterInit(WriterPtr w,GraphSinkPtr sink)
+	{
+	w->sink=sink;
+	w->len=0UL;
+	w->error=0;
+	w->capacity=(sink==NULL?WRITER_MEMORY_SIZE:WRITER_BUFFER_SIZE);
+	w->buffer=(char*)malloc(w->capacity);
+	if(w->buffer==NULL) OUT_OF_MEMORY;
+	}
+
+/** send the pending bytes to the sink */
+static void WriterFlush(WriterPtr w)
+	{
+	if(w->sink==NULL) return;
+	if(w->len>0 && w->error==0 && w->sink->write(w->sink->ctx,w->buffer,w->len)!=0) w->error=-1;
+	w->len=0UL;
+	}
+
+/** flush and release the writer, returns 0 on success */
+static int WriterClose(WriterPtr w)
+	{
+	WriterFlush(w);
+	free(w->buffer);
+	w->buffer=NULL;
+	return w->error;
+	}
+
+/** make room for 'n' more bytes in a memory writer */
+static void WriterGrow(WriterPtr w,size_t n)
+	{
+	while(w->len+n > w->capacity) w->capacity*=2;
+	w->buffer=(char*)realloc(w->buffer,w->capacity);
+	if(w->buffer==NULL) OUT_OF_MEMORY;
+	}
+
+static void WriterWrite(WriterPtr w,const char* data,size_t n)
+	{
+	if(w->len+n > w->capacity)
+		{
+		if(w->sink==NULL)
+			{
+			WriterGrow(w,n);
+			}
+		else
+			{
+			WriterFlush(w);
+			if(n >= w->capacity)
+				{
+				/* too large for the buffer, don't copy it */
+				if(w->error==0 && w->sink->write(w->sink->ctx,data,n)!=0) w->error=-1;
+				return;
+				}
+			}
+		}
+	memcpy(&w->buffer[w->len],data,n);
+	w->len+=n;
+	}
+
+static void WriterPuts(WriterPtr w,const char* s)
+	{
+	WriterWrite(w,s,strlen(s));
+	}
+
+static void WriterPutc(WriterPtr w,char c)
+	{
+	if(w->len==w->capacity)
+		{
+		if(w->sink==NULL) WriterGrow(w,1);
+		else WriterFlush(w);
+		}
+	w->buffer[w->len++]=c;
+	}
+
+/** write an unsigned integer, faster than printf("%zu") */
+static void WriterPutSize(WriterPtr w,size_t n)
+	{
+	char tmp[24];
+	char* p=&tmp[sizeof(tmp)];
+	do	{
+		*--p=(char)('0'+(n%10));
+		n/=10;
+		} while(n>0);
+	WriterWrite(w,p,(size_t)(&tmp[sizeof(tmp)]-p));
+	}
+
+/** write 'n' followed by the id of the target */
+static void WriterPutId(WriterPtr w,const Target* t)
+	{
+	WriterPutc(w,'n');
+	WriterPutSize(w,t->id);
+	}
+
+/** escape a double quote with a backslash */
+static const char* QuoteEscape(char c)
+	{
+	return "\\\"";
+	}
+
+/** escape the XML special characters */
+static const char* XmlEscape(char c)
+	{
+	switch(c)
+		{
+		case '<': return "&lt;";
+		case '>': return "&gt;";
+		case '\"': return "&quot;";
+		case '\'': return "&apos;";
+		default: return "&amp;";
+		}
+	}
+
+/** write 's', each character of 'specials' is replaced by escape(c).
+ * the runs of characters without any special are copied at once.
+ * 's' is copied as is if 'specials' is NULL */
+static void WriterEscaped(WriterPtr w,const char* s,const char* specials,const char* (*escape)(char))
+	{
+	if(specials==NULL)
+		{
+		WriterPuts(w,s);
+		return;
+		}
+	for(;;)
+		{
+		size_t n=strcspn(s,specials);
+		WriterWrite(w,s,n);
+		s+=n;
+		if(*s==0) break;
+		WriterPuts(w,escape(*s));
+		s++;
+		}
+	}
+
+/** write the directory 'n', starting at 'offset' in the component 'from'. 'from' is NULL for the full path */
+static void WriterPutDir(WriterPtr w,const DirNodePtr n,const DirNodePtr from,size_t offset,const char* specials,const char* (*escape)(char))
+	{
+	if(n!=from && n->parent!=NULL)
+		{
+		WriterPutDir(w,n->parent,from,offset,specials,escape);
+		WriterPutc(w,'/');
+		WriterEscaped(w,n->component,specials,escape);
+		}
+	else
+		{
+		WriterEscaped(w,n->component+(n==from?offset:0),specials,escape);
+		}
+	}
+
+/** write the full name of a target */
+static void WriterPutName(WriterPtr w,const Target* t,const char* specials,const char* (*escape)(char))
+	{
+	if(t->dir!=NULL)
+		{
+		WriterPutDir(w,t->dir,NULL,0UL,specials,escape);
+		WriterPutc(w,'/');
+		}
+	WriterEscaped(w,t->leaf,specials,escape);
+	}
+
+/** write the label of a target: the full name, its basename (the last component) or its suffix */
+static void WriterPutLabel(WriterPtr w,GraphPtr g,const Target* t,const char* specials,const char* (*escape)(char))
+	{
+	const char* dot=strrchr(t->leaf,'.');
+	if( g->print_basename_only )
+		{
+		const char* p=t->leaf;
+		if( g->print_suffix_only && dot!=NULL) p=dot+1;
+		WriterEscaped(w,p,specials,escape);
+		return;
+		}
+	if( g->print_suffix_only )
+		{
+		/* the suffix starts after the last '.' of the path */
+		DirNodePtr p;
+		if(dot!=NULL)
+			{
+			WriterEscaped(w,dot+1,specials,escape);
+			return;
+			}
+		for(p=t->dir;p!=NULL;p=p->parent)
+			{
+			dot=strrchr(p->component,'.');
+			if(dot==NULL) continue;
+			WriterPutDir(w,t->dir,p,(size_t)(dot+1-p->component),specials,escape);
+			WriterPutc(w,'/');
+			WriterEscaped(w,t->leaf,specials,escape);
+			return;
+			}
+		}
+	WriterPutName(w,t,specials,escape);
+	}
+
+/** write a label between double quotes for dot, mermaid and plantuml */
+static void WriterQuoted(WriterPtr w,GraphPtr g,const Target* t)
+	{
+	WriterPutLabel(w,g,t,"\"",QuoteEscape);
+	}
+
+/** an output format, split in sections so the targets can be rendered by chunks */
+typedef struct render_format_t
+	{
+	/** before the nodes */
+	void (*head)(WriterPtr w,GraphPtr g);
+	/** the node of one target */
+	void (*node)(WriterPtr w,GraphPtr g,TargetPtr t);
+	/** between the nodes and the edges, or NULL */
+	void (*middle)(WriterPtr w,GraphPtr g);
+	/** the edges of one target, 'k' is the number of edges written before. NULL if the format has no edge */
+	void (*edges)(WriterPtr w,GraphPtr g,TargetPtr t,size_t k);
+	/** after the edges, or NULL */
+	void (*tail)(WriterPtr w,GraphPtr g);
+	}RenderFormat;
+
+/** a range of targets rendered in a buffer of its own */
+typedef struct render_chunk_t
+	{
+	/** render the edges instead of the nodes */
+	int edges;
+	/** first target */
+	size_t begin;
+	/** last target, excluded */
+	size_t end;
+	/** number of edges before the first target */
+	size_t k;
+	/** rendered output */
+	Writer w;
+	/** chunk was rendered */
+	int done;
+	}RenderChunk,*RenderChunkPtr;
+
+/** a multi-threaded rendering */
+typedef struct render_job_t
+	{
+	GraphPtr g;
+	const RenderFormat* format;
+	RenderChunkPtr chunks;
+	size_t chunk_count;
+	/** next chunk to be rendered */
+	size_t next;
+	/** number of chunks already written to the output */
+	size_t written;
+	/** max number of chunks rendered ahead of the output */
+	size_t window;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	}RenderJob,*RenderJobPtr;
+
+/** max number of targets in a chunk */
+#define RENDER_CHUNK_TARGETS 2048
+/** max number of edges in a chunk */
+#define RENDER_CHUNK_EDGES 8192
+
+/** the edges of the hidden root are not printed */
+static int EdgesSkipped(GraphPtr g,TargetPtr t)
+	{
+	return !g->show_root && t==g->root;
+	}
+
+/** render the nodes or the edges of the targets [begin,end( */
+static void RenderRange(WriterPtr w,GraphPtr g,const RenderFormat* f,int edges,size_t begin,size_t end,size_t k)
+	{
+	size_t i;
+	for(i=begin;i< end;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if(!edges)
+			{
+			f->node(w,g,t);
+			}
+		else if(!EdgesSkipped(g,t))
+			{
+			f->edges(w,g,t,k);
+			k+=t->n_children;
+			}
+		}
+	}
+
+static void* RenderWorker(void* arg)
+	{
+	RenderJobPtr job=(RenderJobPtr)arg;
+	for(;;)
+		{
+		RenderChunkPtr c;
+		pthread_mutex_lock(&job->lock);
+		while(job->next< job->chunk_count && job->next >= job->written+job->window)
+			{
+			pthread_cond_wait(&job->cond,&job->lock);
+			}
+		if(job->next>=job->chunk_count)
+			{
+			pthread_mutex_unlock(&job->lock);
+			break;
+			}
+		c=&job->chunks[job->next++];
+		pthread_mutex_unlock(&job->lock);
+
+		WriterInit(&c->w,NULL);
+		RenderRange(&c->w,job->g,job->format,c->edges,c->begin,c->end,c->k);
+
+		pthread_mutex_lock(&job->lock);
+		c->done=1;
+		pthread_cond_broadcast(&job->cond);
+		pthread_mutex_unlock(&job->lock);
+		}
+	return NULL;
+	}
+
+/** append a new chunk to the job */
+static RenderChunkPtr RenderJobAdd(RenderJobPtr job,int edges,size_t begin,size_t k)
+	{
+	RenderChunkPtr c;
+	job->chunks=(RenderChunkPtr)realloc(job->chunks,sizeof(RenderChunk)*(job->chunk_count+1));
+	if(job->chunks==NULL) OUT_OF_MEMORY;
+	c=&job->chunks[job->chunk_count++];
+	memset(c,0,sizeof(RenderChunk));
+	c->edges=edges;
+	c->begin=begin;
+	c->end=begin;
+	c->k=k;
+	return c;
+	}
+
+/** render the nodes and the edges with 'nthreads' threads. The chunks are
+ * rendered in parallel and written in order, so the output is the same as RenderRange */
+static void RenderParallel(WriterPtr w,GraphPtr g,const RenderFormat* f,int nthreads)
+	{
+	RenderJob job;
+	RenderChunkPtr c=NULL;
+	pthread_t* threads;
+	size_t i,k=0UL,n=0UL;
+	int started=0;
+	/* the section between the nodes and the edges was written */
+	int middle=0;
+
+	memset(&job,0,sizeof(RenderJob));
+	job.g=g;
+	job.format=f;
+	job.window=(size_t)nthreads*4;
+	for(i=0;i< g->target_count;++i)
+		{
+		if(c==NULL || c->end-c->begin==RENDER_CHUNK_TARGETS) c=RenderJobAdd(&job,0,i,0UL);
+		c->end=i+1;
+		}
+	c=NULL;
+	if(f->edges!=NULL)
+		{
+		for(i=0;i< g->target_count;++i)
+			{
+			TargetPtr t=g->targets[i];
+			if(c==NULL || c->end-c->begin==RENDER_CHUNK_TARGETS || n>=RENDER_CHUNK_EDGES)
+				{
+				c=RenderJobAdd(&job,1,i,k);
+				n=0UL;
+				}
+			c->end=i+1;
+			if(EdgesSkipped(g,t)) continue;
+			n+=t->n_children;
+			k+=t->n_children;
+			}
+		}
+
+	pthread_mutex_init(&job.lock,NULL);
+	pthread_cond_init(&job.cond,NULL);
+	threads=(pthread_t*)malloc(sizeof(pthread_t)*nthreads);
+	if(threads==NULL) OUT_OF_MEMORY;
+	while(started< nthreads && pthread_create(&threads[started],NULL,RenderWorker,&job)==0) started++;
+	if(started==0)
+		{
+		/* no thread, render everything here */
+		job.window=job.chunk_count;
+		RenderWorker(&job);
+		}
+
+	for(i=0;i< job.chunk_count;++i)
+		{
+		c=&job.chunks[i];
+		pthread_mutex_lock(&job.lock);
+		while(!c->done) pthread_cond_wait(&job.cond,&job.lock);
+		pthread_mutex_unlock(&job.lock);
+
+		if(c->edges && !middle)
+			{
+			if(f->middle!=NULL) f->middle(w,g);
+			middle=1;
+			}
+		WriterWrite(w,c->w.buffer,c->w.len);
+		WriterClose(&c->w);
+
+		pthread_mutex_lock(&job.lock);
+		job.written++;
+		pthread_cond_broadcast(&job.cond);
+		pthread_mutex_unlock(&job.lock);
+		}
+	if(!middle && f->middle!=NULL) f->middle(w,g);
+
+	while(started>0) pthread_join(threads[--started],NULL);
+	free(threads);
+	pthread_cond_destroy(&job.cond);
+	pthread_mutex_destroy(&job.lock);
+	free(job.chunks);
+	}
+
+/** render the graph with the given format, using the threads of the graph */
+static int GraphRender(GraphPtr g,const RenderFormat* f,GraphSinkPtr out)
+	{
+	Writer w;
+	GraphSortTargets(g);
+	WriterInit(&w,out);
+	if(f->head!=NULL) f->head(&w,g);
+	if(g->threads>1 && g->target_count > RENDER_CHUNK_TARGETS)
+		{
+		RenderParallel(&w,g,f,g->threads);
+		}
+	else
+		{
+		RenderRange(&w,g,f,0,0,g->target_count,0UL);
+		if(f->middle!=NULL) f->middle(&w,g);
+		if(f->edges!=NULL) RenderRange(&w,g,f,1,0,g->target_count,0UL);
+		}
+	if(f->tail!=NULL) f->tail(&w,g);
+	return WriterClose(&w);
+	}
+
+/** graphiz dot: header */
+static void DotHead(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,"digraph G {\n");
+	if (g->truncated!=NULL)
+		{
+		WriterPuts(w,"// truncated: ");
+		WriterPuts(w,g->truncated);
+		WriterPutc(w,'\n');
+		}
+
+	if (g->graph_attributes!=NULL)
+		{
+		WriterPuts(w,"graph [");
+		WriterPuts(w,g->graph_attributes);
+		WriterPuts(w,"];\n");
+		}
+
+	if (g->node_attributes!=NULL)
+		{
+		WriterPuts(w,"node [");
+		WriterPuts(w,g->node_attributes);
+		WriterPuts(w,"];\n");
+		}
+	else if (g->colorscheme!=NULL)
+		{
+		WriterPuts(w,"node [colorscheme=\"");
+		WriterPuts(w,g->colorscheme);
+		WriterPuts(w,"\"];\n");
+		}
+
+	if (g->edge_attributes!=NULL)
+		{
+		WriterPuts(w,"edge [");
+		WriterPuts(w,g->edge_attributes);
+		WriterPuts(w,"];\n");
+		}
+	}
+
+/** graphiz dot: node */
+static void DotNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if( !g->show_root && t==g->root ) return;
+
+	if(t==g->root)
+		{
+		WriterPutId(w,t);
+		WriterPuts(w,"[shape=point, label=\"\"];\n");
+		}
+	else
+		{
+		WriterPutId(w,t);
+		WriterPuts(w," [label=\"");
+		WriterQuoted(w,g,t);
+		WriterPutc(w,'\"');
+
+		if (g->colorscheme != NULL)
+			{
+			WriterPuts(w,", style=filled, fillcolor=");
+			WriterPutSize(w,t->level);
+			}
+
+		if (t->must_remake && g->dirty_attributes!=NULL)
+			{
+			WriterPuts(w,", ");
+			WriterPuts(w,g->dirty_attributes);
+			WriterPuts(w,"];\n");
+			}
+		else
+			{
+			WriterPuts(w,t->must_remake ? ", color=\"red\"];\n" : ", color=\"forestgreen\"];\n");
+			}
+		}
+	}
+
+/** graphiz dot: edges */
+static void DotEdges(WriterPtr w,GraphPtr g,TargetPtr t,size_t k)
+	{
+	size_t j;
+	for(j=0; j< t->n_children; ++j)
+		{
+		TargetPtr c = t->children[j];
+		WriterPutId(w,c);
+		WriterPuts(w," -> ");
+		WriterPutId(w,t);
+		WriterPuts(w," ; \n");
+		}
+	}
+
+/** graphiz dot: footer */
+static void DotTail(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,"}\n");
+	}
+
+static const RenderFormat DotFormat={DotHead,DotNode,NULL,DotEdges,DotTail};
+
+int DumpGraphAsDot(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&DotFormat,out);
+	}
+
+/** mermaid: header */
+static void MermaidHead(WriterPtr w,GraphPtr g)
+	{
+	if (g->colorscheme != NULL)
+		{
+		WriterPuts(w,"%%{ init: { 'theme': '");
+		WriterPuts(w,g->colorscheme);
+		WriterPuts(w,"' } }%%\n");
+		}
+
+	WriterPuts(w,"flowchart TD\n");
+	if (g->truncated!=NULL)
+		{
+		WriterPuts(w,"    %% truncated: ");
+		WriterPuts(w,g->truncated);
+		WriterPutc(w,'\n');
+		}
+
+	if (g->graph_attributes!=NULL)
+		{
+		WriterPuts(w,"    classDef default ");
+		WriterPuts(w,g->graph_attributes);
+		WriterPutc(w,'\n');
+		}
+	if (g->node_attributes!=NULL)
+		{
+		WriterPuts(w,"    classDef node ");
+		WriterPuts(w,g->node_attributes);
+		WriterPutc(w,'\n');
+		}
+	if (g->edge_attributes!=NULL)
+		{
+		WriterPuts(w,"    linkStyle default ");
+		WriterPuts(w,g->edge_attributes);
+		WriterPutc(w,'\n');
+		}
+	if (g->dirty_attributes != NULL)
+		{
+		WriterPuts(w,"    classDef dirty ");
+		WriterPuts(w,g->dirty_attributes);
+		WriterPutc(w,'\n');
+		}
+	}
+
+/** mermaid: node */
+static void MermaidNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if( !g->show_root && t==g->root ) return;
+
+	WriterPuts(w,"    ");
+	WriterPutId(w,t);
+	if(t==g->root)
+		WriterPuts(w,"{ }\n");
+	else
+		{
+		WriterPuts(w,t->must_remake ? "{{\"" : "(\"");
+		WriterQuoted(w,g,t);
+		WriterPuts(w,t->must_remake ? "\"}}:::dirty\n" : "\")\n");
+		}
+	}
+
+/** mermaid: edges */
+static void MermaidEdges(WriterPtr w,GraphPtr g,TargetPtr t,size_t k)
+	{
+	size_t j;
+	for(j=0; j< t->n_children; ++j)
+		{
+		TargetPtr c = t->children[j];
+		WriterPuts(w,"    ");
+		WriterPutId(w,c);
+		WriterPuts(w," --> ");
+		WriterPutId(w,t);
+		WriterPutc(w,'\n');
+		}
+	}
+
+static const RenderFormat MermaidFormat={MermaidHead,MermaidNode,NULL,MermaidEdges,NULL};
+
+int DumpGraphAsMermaid(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&MermaidFormat,out);
+	}
+
+/** plantuml: header */
+static void PlantUMLHead(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,"@startuml\n\nhide empty description\n\n");
+	if (g->truncated!=NULL)
+		{
+		WriterPuts(w,"' truncated: ");
+		WriterPuts(w,g->truncated);
+		WriterPuts(w,"\n\n");
+		}
+	if (g->colorscheme != NULL)
+		{
+		WriterPuts(w,"!theme");
+		WriterPuts(w,g->colorscheme);
+		WriterPutc(w,'\n');
+		}
+
+	if (g->graph_attributes!=NULL)
+		{
+		WriterPuts(w,"' graph attributes\n");
+		WriterPuts(w,g->graph_attributes);
+		WriterPuts(w,"\n\n");
+		}
+	if (g->node_attributes!=NULL)
+		{
+		WriterPuts(w,"skinparam state {\n  ");
+		WriterPuts(w,g->node_attributes);
+		WriterPuts(w,"\n}\n\n");
+		}
+	if (g->dirty_attributes != NULL)
+		{
+		WriterPuts(w,"skinparam state<<dirty>> {\n  ");
+		WriterPuts(w,g->dirty_attributes);
+		WriterPuts(w,"\n}\n\n");
+		}
+	}
+
+/** plantuml: node */
+static void PlantUMLNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if( g->show_root && t==g->root )
+		{
+		WriterPuts(w,"state \" \" as root {\n");
+		if (g->edge_attributes != NULL)
+			{
+			WriterPuts(w,"    ' edge attributes\n    ");
+			WriterPuts(w,g->edge_attributes);
+			WriterPuts(w,"\n\n");
+			}
+		}
+	else
+		{
+		WriterPuts(w,"    state \"");
+		WriterQuoted(w,g,t);
+		WriterPuts(w,"\" as ");
+		WriterPutId(w,t);
+		WriterPuts(w,t->must_remake ? " <<dirty>>\n" : " <<node>>\n");
+		}
+	}
+
+/** plantuml: between the states and the transitions */
+static void PlantUMLMiddle(WriterPtr w,GraphPtr g)
+	{
+	WriterPutc(w,'\n');
+	}
+
+/** plantuml: edges */
+static void PlantUMLEdges(WriterPtr w,GraphPtr g,TargetPtr t,size_t k)
+	{
+	size_t j;
+	for(j=0; j< t->n_children; ++j)
+		{
+		TargetPtr c = t->children[j];
+		if (t->id == 1)
+			{
+			WriterPuts(w,"    [*] --> ");
+			}
+		else
+			{
+			WriterPuts(w,"    ");
+			WriterPutId(w,t);
+			WriterPuts(w," --> ");
+			}
+		WriterPutId(w,c);
+		WriterPutc(w,'\n');
+		}
+	}
+
+/** plantuml: footer */
+static void PlantUMLTail(WriterPtr w,GraphPtr g)
+	{
+	if( g->show_root )
+		WriterPuts(w,"}\n");
+	WriterPuts(w,"@enduml\n\n");
+	}
+
+static const RenderFormat PlantUMLFormat={PlantUMLHead,PlantUMLNode,PlantUMLMiddle,PlantUMLEdges,PlantUMLTail};
+
+int DumpGraphAsPlantUML(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&PlantUMLFormat,out);
+	}
+
+/** gexf: header */
+static void GexfHead(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<gexf xmlns=\"http://www.gexf.net/1.2draft\" version=\"1.2\">\n"
+		"  <meta>\n"
+		"    <creator>https://github.com/lindenb/makefile2graph version:" M2G_VERSION "</creator>\n"
+		"    <description>Creates a graph from a Makefile");
+	if (g->truncated!=NULL)
+		{
+		WriterPuts(w," (truncated: ");
+		WriterPuts(w,g->truncated);
+		WriterPutc(w,')');
+		}
+	WriterPuts(w,"</description>\n"
+		"  </meta>\n"
+		"  <graph mode=\"static\" defaultedgetype=\"directed\">\n"
+		"    <attributes class=\"node\" mode=\"static\"/>\n"
+		"    <nodes>\n");
+	}
+
+/** gexf: node */
+static void GexfNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if( !g->show_root && t==g->root ) return;
+
+	WriterPuts(w,"      <node id=\"");
+	WriterPutId(w,t);
+	WriterPuts(w,"\" label=\"");
+	WriterPutLabel(w,g,t,"<>\"'&",XmlEscape);
+	WriterPuts(w,"\"/>\n");
+	}
+
+/** gexf: between the nodes and the edges */
+static void GexfMiddle(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,"    </nodes>\n");
+	WriterPuts(w,"    <edges>\n");
+	}
+
+/** gexf: edges, 'k' is used to number the edges */
+static void GexfEdges(WriterPtr w,GraphPtr g,TargetPtr t,size_t k)
+	{
+	size_t j;
+	for(j=0; j< t->n_children; ++j)
+		{
+		TargetPtr c = t->children[j];
+		WriterPuts(w,"      <edge id=\"E");
+		WriterPutSize(w,++k);
+		WriterPuts(w,"\" type=\"directed\" source=\"");
+		WriterPutId(w,c);
+		WriterPuts(w,"\" target=\"");
+		WriterPutId(w,t);
+		WriterPuts(w,"\"/>\n");
+		}
+	}
+
+/** gexf: footer */
+static void GexfTail(WriterPtr w,GraphPtr g)
+	{
+	WriterPuts(w,
+		"    </edges>\n"
+		"  </graph>\n"
+		"</gexf>\n");
+	}
+
+static const RenderFormat GexfFormat={GexfHead,GexfNode,GexfMiddle,GexfEdges,GexfTail};
+
+int DumpGraphAsGexf(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&GexfFormat,out);
+	}
+
+/** sets t->deep for all the targets: a target is deep if it must be remade and none of its
+ * prerequisites, direct or not, must be remade. Computed once per component, in reverse
+ * topological order, so it is linear and terminates on cycles: the targets of a cycle share
+ * their prerequisites but don't prevent each other from being deep. */
+static void GraphDeepFlags(GraphPtr g)
+	{
+	size_t i,j,k,count=GraphComponents(g);
+	size_t* offsets;
+	size_t* members=GraphComponentMembers(g,count,&offsets);
+	/* some target of the component or one of its prerequisites must be remade */
+	char* dirty=(char*)calloc(count+1,sizeof(char));
+	if(dirty==NULL) OUT_OF_MEMORY;
+	for(k=0;k< count;++k)
+		{
+		/* a prerequisite outside of the component must be remade */
+		int blocked=0;
+		for(i=offsets[k];i< offsets[k+1];++i)
+			{
+			TargetPtr t=g->targets[members[i]];
+			if(t->must_remake) dirty[k]=1;
+			for(j=0;j< t->n_children;++j)
+				{
+				TargetPtr c=t->children[j];
+				/* the components of the prerequisites are already computed */
+				if(c->component!=k && dirty[c->component]) blocked=1;
+				}
+			}
+		if(blocked) dirty[k]=1;
+		for(i=offsets[k];i< offsets[k+1];++i)
+			{
+			TargetPtr t=g->targets[members[i]];
+			t->deep=(t->must_remake && !blocked);
+			}
+		}
+	free(dirty);
+	free(members);
+	free(offsets);
+	}
+
+/** deep: one line per deep target */
+static void DeepNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if(!t->deep) return;
+	WriterPutName(w,t,NULL,NULL);
+	WriterPutc(w,'\n');
+	}
+
+static const RenderFormat DeepFormat={NULL,DeepNode,NULL,NULL,NULL};
+
+int DumpGraphAsDeep(GraphPtr g,GraphSinkPtr out)
+	{
+	GraphDeepFlags(g);
+	return GraphRender(g,&DeepFormat,out);
+	}
+
+/** list: one line per target */
+static void ListNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	WriterPutName(w,t,NULL,NULL);
+	WriterPutc(w,'\n');
+	}
+
+static const RenderFormat ListFormat={NULL,ListNode,NULL,NULL,NULL};
+
+int DumpGraphAsList(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&ListFormat,out);
+	}
+
+/** scc: one line per cycle (strongly connected component of more than one target),
+ * per target depending on itself and per target that cannot be reached from <ROOT> */
+int DumpGraphAsScc(GraphPtr g,GraphSinkPtr out)
+	{
+	Writer w;
+	size_t i,j,count=GraphComponents(g);
+	size_t* offsets;
+	size_t* members=GraphComponentMembers(g,count,&offsets);
+	char* seen=GraphReachable(g);
+	WriterInit(&w,out);
+	/* the cycles are printed in the order of their first target */
+	for(i=0;i< g->target_count;++i)
+		{
+		size_t k=g->targets[i]->component;
+		if(offsets[k+1]-offsets[k]<2 || members[offsets[k]]!=i) continue;
+		WriterPuts(&w,"cycle\t");
+		WriterPutSize(&w,offsets[k+1]-offsets[k]);
+		for(j=offsets[k];j< offsets[k+1];++j)
+			{
+			WriterPutc(&w,'\t');
+			WriterPutName(&w,g->targets[members[j]],NULL,NULL);
+			}
+		WriterPutc(&w,'\n');
+		}
+	for(i=0;i< g->target_count;++i)
+		{
+		if(!TargetHasSelfEdge(g->targets[i])) continue;
+		WriterPuts(&w,"self-edge\t");
+		WriterPutName(&w,g->targets[i],NULL,NULL);
+		WriterPutc(&w,'\n');
+		}
+	for(i=0;i< g->target_count;++i)
+		{
+		if(seen[i]) continue;
+		WriterPuts(&w,"unreachable\t");
+		WriterPutName(&w,g->targets[i],NULL,NULL);
+		WriterPutc(&w,'\n');
+		}
+	free(seen);
+	free(members);
+	free(offsets);
+	return WriterClose(&w);
+	}
+
+/** escape the JSON special characters */
+static const char* JsonEscape(char c)
+	{
+	static const char* controls[32]={
+		"\\u0000","\\u0001","\\u0002","\\u0003","\\u0004","\\u0005","\\u0006","\\u0007",
+		"\\b","\\t","\\n","\\u000b","\\f","\\r","\\u000e","\\u000f",
+		"\\u0010","\\u0011","\\u0012","\\u0013","\\u0014","\\u0015","\\u0016","\\u0017",
+		"\\u0018","\\u0019","\\u001a","\\u001b","\\u001c","\\u001d","\\u001e","\\u001f"
+		};
+	if(c=='\"') return "\\\"";
+	if(c=='\\') return "\\\\";
+	return controls[(unsigned char)c];
+	}
+
+/** characters escaped in a JSON string */
+#define JSON_SPECIALS "\"\\\001\002\003\004\005\006\007\010\011\012\013\014\015\016\017\020\021\022\023\024\025\026\027\030\031\032\033\034\035\036\037"
+
+/** json lines: a first object if the input was truncated */
+static void JsonHead(WriterPtr w,GraphPtr g)
+	{
+	if (g->truncated==NULL) return;
+	WriterPuts(w,"{\"type\":\"truncated\",\"reason\":\"");
+	WriterPuts(w,g->truncated);
+	WriterPuts(w,"\"}\n");
+	}
+
+/** json lines: one object per target */
+static void JsonNode(WriterPtr w,GraphPtr g,TargetPtr t)
+	{
+	if( !g->show_root && t==g->root ) return;
+
+	WriterPuts(w,"{\"type\":\"node\",\"id\":");
+	WriterPutSize(w,t->id);
+	WriterPuts(w,",\"name\":\"");
+	WriterPutName(w,t,JSON_SPECIALS,JsonEscape);
+	WriterPuts(w,t->must_remake ? "\",\"dirty\":true,\"depth\":" : "\",\"dirty\":false,\"depth\":");
+	WriterPutSize(w,t->level);
+	WriterPuts(w,t==g->root ? ",\"root\":true}\n" : "}\n");
+	}
+
+/** json lines: one object per edge, from the prerequisite to the target as in dot */
+static void JsonEdges(WriterPtr w,GraphPtr g,TargetPtr t,size_t k)
+	{
+	size_t j;
+	for(j=0; j< t->n_children; ++j)
+		{
+		TargetPtr c = t->children[j];
+		WriterPuts(w,"{\"type\":\"edge\",\"source\":");
+		WriterPutSize(w,c->id);
+		WriterPuts(w,",\"target\":");
+		WriterPutSize(w,t->id);
+		WriterPuts(w,"}\n");
+		}
+	}
+
+static const RenderFormat JsonLinesFormat={JsonHead,JsonNode,NULL,JsonEdges,NULL};
+
+int DumpGraphAsJsonLines(GraphPtr g,GraphSinkPtr out)
+	{
+	return GraphRender(g,&JsonLinesFormat,out);
+	}
+
+/** write a little-endian 32 bits integer */
+static void WriterPutU32(WriterPtr w,unsigned long v)
+	{
+	char b[4];
+	int i;
+	for(i=0;i<4;++i) b[i]=(char)((v>>(8*i))&0xFF);
+	WriterWrite(w,b,4);
+	}
+
+/** write a little-endian 64 bits integer */
+static void WriterPutU64(WriterPtr w,unsigned long long v)
+	{
+	char b[8];
+	int i;
+	for(i=0;i<8;++i) b[i]=(char)((v>>(8*i))&0xFF);
+	WriterWrite(w,b,8);
+	}
+
+/** write zeros up to a multiple of 8 bytes */
+static void WriterPad8(WriterPtr w,size_t written)
+	{
+	while(written%8!=0)
+		{
+		WriterPutc(w,0);
+		written++;
+		}
+	}
+
+/** round up to a multiple of 8 */
+#define ALIGN8(n) (((n)+7)&~((size_t)7))
+
+int DumpGraphAsBinary(GraphPtr g,GraphSinkPtr out)
+	{
+	Writer w;
+	size_t i,j,n=0UL,e=0UL,strings_size=0UL,offset;
+	size_t sections[7];
+	/* the hidden root is not a node, the nodes after it are shifted */
+	size_t hidden;
+	GraphSortTargets(g);
+	WriterInit(&w,out);
+	hidden=(g->show_root?g->target_count:g->root->index);
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		n++;
+		e+=t->n_children;
+		strings_size+=TargetPathLength(t)+1;
+		}
+
+	offset=BINARY_HEADER_SIZE;
+	sections[0]=offset; offset+=ALIGN8(8*n);	/* ids */
+	sections[1]=offset; offset+=ALIGN8(8*(n+1));	/* name offsets */
+	sections[2]=offset; offset+=ALIGN8(4*n);	/* flags */
+	sections[3]=offset; offset+=ALIGN8(4*n);	/* depths */
+	sections[4]=offset; offset+=ALIGN8(8*(n+1));	/* edge offsets */
+	sections[5]=offset; offset+=ALIGN8(8*e);	/* edges */
+	sections[6]=offset;				/* strings */
+
+	WriterWrite(&w,BINARY_MAGIC,8);
+	WriterPutU32(&w,BINARY_VERSION);
+	WriterPutU32(&w,g->truncated!=NULL?BINARY_FLAG_TRUNCATED:0UL);
+	WriterPutU64(&w,n);
+	WriterPutU64(&w,e);
+	WriterPutU64(&w,strings_size);
+	for(i=0;i<7;++i) WriterPutU64(&w,sections[i]);
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		WriterPutU64(&w,t->id);
+		}
+	WriterPad8(&w,8*n);
+
+	offset=0UL;
+	WriterPutU64(&w,offset);
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		offset+=TargetPathLength(t)+1;
+		WriterPutU64(&w,offset);
+		}
+	WriterPad8(&w,8*(n+1));
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		WriterPutU32(&w,(t->must_remake?BINARY_FLAG_DIRTY:0)|(t==g->root?BINARY_FLAG_ROOT:0));
+		}
+	WriterPad8(&w,4*n);
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		WriterPutU32(&w,t->level);
+		}
+	WriterPad8(&w,4*n);
+
+	offset=0UL;
+	WriterPutU64(&w,offset);
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		offset+=t->n_children;
+		WriterPutU64(&w,offset);
+		}
+	WriterPad8(&w,8*(n+1));
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		for(j=0;j< t->n_children;++j)
+			{
+			size_t k=t->children[j]->index;
+			WriterPutU64(&w,k>hidden?k-1:k);
+			}
+		}
+	WriterPad8(&w,8*e);
+
+	for(i=0;i< g->target_count;++i)
+		{
+		TargetPtr t=g->targets[i];
+		if( !g->show_root && t==g->root ) continue;
+		WriterPutName(&w,t,NULL,NULL);
+		WriterPutc(&w,0);
+		}
+	WriterPad8(&w,strings_size);
+	return WriterClose(&w);
+	}
+
+int GraphParseFormat(const char* s)
+	{
+	if(s==NULL) return -1;
+	switch(s[0])
+		{
+		case 'x':case 'X':
+		case 'g':case 'G': return output_gexf;
+		case 'm':case 'M': return output_mermaid;
+		case 'p':case 'P': return output_plantuml;
+		case 'd':case 'D': return output_dot;
+		case 'e':case 'E': return output_deep;
+		case 'l':case 'L': return output_list;
+		case 'j':case 'J': return output_jsonl;
+		case 'b':case 'B': return output_bin;
+		case 's':case 'S': return output_scc;
+		default: return -1;
+		}
+	}
+
+int GraphDump(GraphPtr g,int format,GraphSinkPtr sink)
+	{
+	switch(format)
+		{
+		case output_gexf : return DumpGraphAsGexf(g,sink);
+		case output_mermaid: return DumpGraphAsMermaid(g,sink);
+		case output_plantuml: return DumpGraphAsPlantUML(g,sink);
+		case output_deep: return DumpGraphAsDeep(g,sink);
+		case output_list : return DumpGraphAsList(g,sink);
+		case output_jsonl : return DumpGraphAsJsonLines(g,sink);
+		case output_bin : return DumpGraphAsBinary(g,sink);
+		case output_scc : return DumpGraphAsScc(g,sink);
+		case output_dot :
+		default: return DumpGraphAsDot(g,sink);
+		}
+	}
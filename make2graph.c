@@ -30,648 +30,59 @@ History:
    * Dec  2014: new output. Print the deepest independant targets
    * Desc 2014: MacOS bug, changed options
    * Aug  2023: colorscheme, graph, node, and edge attributes
+   * 2026: make2graph is a client of libmake2graph
 
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <getopt.h>
-#include <assert.h>
+#include <poll.h>
+#include "make2graph.h"
+#include "serve.h"
 
-/* version */
-#define M2G_VERSION "1.5.0"
-
-#define OUT_OF_MEMORY do { fprintf(stderr,"%s: %d : OUT_OF_MEMORY.\n",__FILE__,__LINE__); exit(EXIT_FAILURE);} while(0)
-
-/* as https://github.com/lindenb/makefile2graph/issues/9 */
-static char* StrNDup (const char *s, size_t n)
-{
-  char *result;
-  size_t len = strlen (s);
-
-  if (n < len)
-    len = n;
-
-  result = (char *) malloc (len + 1);
-  if (!result)
-    return 0;
-
-  result[len] = '\0';
-  return (char *) memcpy (result, s, len);
-}
-
-enum output_type {
-	output_dot,
-	output_gexf,
-	output_mermaid,
-	output_plantuml,
-	output_deep,
-	output_list
-	};
-
-/** a Target */
-typedef struct target_t
-	{
-	/* target id */
-	size_t id;
-	/* filename */
-	char* name;
-	/* associated children, sorted by name */
-	struct target_t** children;
-	/* number of children */
-	size_t n_children;
-	/* number of children */
-	size_t level;
-	/* target is dirty */
-	int must_remake;
-	}Target,*TargetPtr;
-
-/** the Makefile graph */
-typedef struct make2graph_t
-	{
-	/** all the targets , sorted by name */
-	TargetPtr* targets;
-	/** number of target */
-	size_t target_count;
-	/** root target */
-	TargetPtr root;
-	/** target id-generator */
-	size_t id_generator;
-	/** flag print only basename */
-	int print_basename_only;
-	/** flag print only extension */
-	int print_suffix_only;
-	/** show <root> node https://github.com/lindenb/makefile2graph/issues/3 */
-	int show_root;
-	/** sets colorscheme applied interleaved to all nodes */
-	char *colorscheme;
-	/** sets attributes applied to the graph */
-	char *graph_attributes;
-	/** sets attributes applied to all nodes */
-	char *node_attributes;
-	/** sets attributes applied to all edges */
-	char *edge_attributes;
-	/** sets attributes applied to dirty nodes only */
-	char *dirty_attributes;
-	}Graph,*GraphPtr;
-
-
-/** compare target by name */
-static int TargetCmp(const void * a, const void * b)
-	{
-	return strcmp((*(TargetPtr*)a)->name,(*(TargetPtr*)b)->name);
-	}
-
-/** creates a new target */
-static TargetPtr TargetNew(GraphPtr graph,const char* name)
-	{
-	TargetPtr target=(TargetPtr)calloc(1,sizeof(Target));
-	if(target==NULL) OUT_OF_MEMORY;
-	target->id=(++graph->id_generator);
-	target->name=strdup(name);
-	if(target->name==NULL) OUT_OF_MEMORY;
-	target->level=0;
-	return target;
-	}
-
-/** add a children to the specified target */
-static void TargetAddChildren(TargetPtr root, TargetPtr c)
-	{
-	TargetPtr* t=(TargetPtr*)bsearch((const void*)&c, (void*)root->children, root->n_children, sizeof(TargetPtr),TargetCmp);
-        if(t!=0) return;
-	root->children=realloc(root->children,sizeof(TargetPtr)*(root->n_children+1));
-	if(root->children==NULL)  OUT_OF_MEMORY;
-	root->children[root->n_children++]=c;
-	c->level=root->level+1;
-	qsort(root->children, root->n_children ,sizeof(TargetPtr) , TargetCmp);
-	}
-
-/** does string starts with substring */
-static int startsWith(const char* str,const char* pre)
-	{
-    	size_t lenpre = strlen(pre), lenstr = strlen(str);
-   	return lenstr < lenpre ? 0 : strncmp(pre, str, lenpre) == 0;
-  }
-
-static int endsWith(const char *str, const char *suffix)
-{
-  if (!str || !suffix)
-    return 0;
-  size_t lenstr = strlen(str);
-  size_t lensuffix = strlen(suffix);
-  if (lensuffix >  lenstr)
-    return 0;
-  return strncmp(str + lenstr - lensuffix, suffix, lensuffix) == 0;
-}
-
-
-/** extract filename between '`' and "'" 
- * Make v4.0 changed this: the first separator is now "'"
- */
-static char* targetName(const char* line)
-	{
-	char* p;
-	char* b=strchr(line,'`');
-	if(b==NULL) b=strchr(line,'\'');//GNU make 4.0
-      	char* e=( b==NULL ? NULL : strchr(b+1,'\'') );
-      	if(b==NULL  || e==NULL || b>e)
-      		{
-      		fprintf(stderr,"Cannot get target name in \"%s\".\n",line);
-      		exit(EXIT_FAILURE);
-      		}
-        p= StrNDup(b+1,(e-b)-1);
-	if(p==NULL) OUT_OF_MEMORY;
-	return p;
-	}
-
-/** get a label for this target name */
-static char* targetLabel(GraphPtr g,const char* s)
-	{
-	char* p=(char*)s;
-	if( g->print_basename_only )
-		{
-		char* slash=strrchr(p,'/');
-		if(slash!=NULL) p=slash+1;
-		}
-	if( g->print_suffix_only )
-		{
-		char* slash=strrchr(p,'.');
-		if(slash!=NULL) p=slash+1;
-		}
-	return p;
-	}
-
-/** read line character by character */
-static char* readline(FILE* in, size_t* level)
-	{
-	assert(level);
-	*level= 0UL;
-	int c;
-	char* p=NULL;
-	size_t len=0UL;
-	if(feof(in)) return NULL;
-	p=(char*)malloc(sizeof(char));
-	if(p==NULL) OUT_OF_MEMORY;
-	while((c=fgetc(in))!=-1 && c!='\n')
-		{
-		p=(char*)realloc((char*)p,sizeof(char)*(len+2));
-		if(p==NULL) OUT_OF_MEMORY;
-		if(!(len==0 && isspace(c))) /* trim on the fly */
-			{
-			p[len++]=c;
-			}
-		    else
-			{
-			(*level)++;
-			}
-		}
-	p[len]=0;
-	return p;
-	}
- 
- /** get target, create it it doesn't exist */
-static TargetPtr GraphGetTarget(GraphPtr graph,const char* name)
-        {
-        TargetPtr t;
-	Target key;
-	TargetPtr pkey=&key;
-	key.name=(char*)name;
-	TargetPtr* prev=(TargetPtr*)bsearch(
-		(const void*) &pkey,
-		(void*)graph->targets,
-		graph->target_count,
-		sizeof(TargetPtr),
-		TargetCmp
-		);
-	
-        if(prev!=0)
-		{
-		return *prev;
-	    	}
-
-        t=TargetNew(graph,name);
-	graph->targets = (TargetPtr*)realloc(
-		(void*)graph->targets,
-		sizeof(TargetPtr)*(1+graph->target_count)
-		);
-	if(graph->targets==NULL) OUT_OF_MEMORY;
-	graph->targets[ graph->target_count ] = t;
-	graph->target_count++;
-	qsort(graph->targets, graph->target_count ,sizeof(TargetPtr) , TargetCmp);
-
-	return t;
-        }
-
-/** scan the makefile -nd output */
-static void GraphScan(GraphPtr graph,TargetPtr root,FILE* in, size_t level)
-	{
-	char* line=NULL;
-	char* makefile_name=NULL;
-	size_t iLevel=0UL;
-	while((line=readline(in, &iLevel))!=NULL)
-		{
-		 if(startsWith(line,"Considering target file"))
-		        {
-		        char* tName=targetName(line);
-		        if(!graph->show_root && 
-		           makefile_name!=NULL &&
-		           strcmp(tName,makefile_name)==0)
-		        	{
-		        	free(tName);
-		        	free(line);
-		        	//skip lines
-				size_t iLevelDump=0UL;
-		        	while((line=readline(in, &iLevelDump))!=NULL)
-		        		{
-                if(startsWith(line,"Finished prerequisites of target file ") || endsWith(line, "was considered already.") )
-						{
-						tName=targetName(line);
-						free(line);
-						if(strcmp(tName,makefile_name)==0)
-							{
-							free(tName);
-							break;
-							}
-						free(tName);
-						continue;
-						}
-					free(line);
-					}
-		        	continue;
-		        	} 
-
-		        TargetPtr child=GraphGetTarget(graph,tName);
-
-			// fprintf(stderr, "a: %zu(%s)->%zu(%s)\n", level, root->name, iLevel, tName);
-		        free(tName);
-
-			if(level+1 >= iLevel)
-			    {
-			    TargetAddChildren(root,child);
-			    // fprintf(stderr, "b: %zu(%s)->%zu(%s)\n", level, root->name, iLevel, child->name);
-			    GraphScan(graph,child,in,iLevel+1);
-			    }
-
-		        }
-		    else if(startsWith(line,"Must remake target "))
-			     {
-			     char* tName=targetName(line);
-			     GraphGetTarget(graph,tName)->must_remake=1;
-			     free(tName);
-			     }
-		    else if(startsWith(line,"Pruning file "))
-			     {
-			     char* tName=targetName(line);
-			     TargetAddChildren(root,GraphGetTarget(graph,tName));
-			     free(tName);
-			     }
-        else if( (startsWith(line,"Finished prerequisites of target file ") || endsWith(line, "was considered already.")) && (level+1 >= iLevel))
-			{
-			char* tName=targetName(line);
-			if(strcmp(tName,root->name)!=0)
-				 {
-				 fprintf(stderr,"expected %s got %s\n", root->name , line);
-				 exit(EXIT_FAILURE);
-				 }
-			free(tName);
-			free(line);
-			break;
-			}
-		    else if(startsWith(line,"Reading makefile "))
-			{
-			free(makefile_name);
-			makefile_name=targetName(line);
-			}
-		       
-		free(line);
-		}
-	free(makefile_name);
-	}
-
-
-/** export a graphiz dot */
-static void DumpGraphAsDot(GraphPtr g,FILE* out)
-	{
-	size_t i=0,j=0;
-
-	fputs("digraph G {\n",out);
-
-	if (g->graph_attributes!=NULL)
-		fprintf(out,
-			"graph [%s];\n",
-			(g->graph_attributes));
-	
-	if (g->node_attributes!=NULL)
-		fprintf(out,
-			"node [%s];\n",
-			(g->node_attributes));
-	else if (g->colorscheme!=NULL)
-		fprintf(out,
-			"node [colorscheme=\"%s\"];\n",
-			(g->colorscheme));
-
-	if (g->edge_attributes!=NULL)
-		fprintf(out,
-			"edge [%s];\n",
-			(g->edge_attributes));
-
-	for(i=0; i< g->target_count; ++i)
-		{
-
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root ) continue;
-		
-		if(t==g->root)
-			{
-			fprintf(out,
-				"n%zu[shape=point, label=\"\"];\n",
-				t->id
-				);
-			}
-		else
-			{
-			const char* label=targetLabel(g,t->name);
-			fprintf(out,
-				"n%zu [label=\"",
-				t->id);
-			while(*label)
-				{
-				if(*label=='\"')
-					fputs("\\\"",out);
-				else
-					fputc(*label,out);
-				label++;
-				}
-			fputs("\"", out);
-
-			if (g->colorscheme != NULL)
-				fprintf(out,
-					", style=filled, fillcolor=%zu",
-					t->level);
-			
-			if (t->must_remake && g->dirty_attributes!=NULL)
-				fprintf(out,
-						", %s];\n",
-						(g->dirty_attributes));
-			else 
-				fprintf(out,
-					", color=\"%s\"];\n",
-					t->must_remake ? "red" : "forestgreen");
-			}
-
-		}
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root) continue;
-		
-		for(j=0; j< t->n_children; ++j)
-			{
-			TargetPtr c = t->children[j];
-			fprintf(out,"n%zu -> n%zu ; \n", c->id , t->id);
-			}
-		}
-	fputs("}\n",out);
-	}
-
-/** export a mermaid flowchart */
-static void DumpGraphAsMermaid(GraphPtr g,FILE* out)
-	{
-	size_t i=0,j=0;
-
-	if (g->colorscheme != NULL)
-			fprintf(out, "%%%%{ init: { 'theme': '%s' } }%%%%\n",
-					g->colorscheme);
-
-	fputs("flowchart TD\n", out);
-	
-	if (g->graph_attributes!=NULL)
-		fprintf(out, "    classDef default %s\n", g->graph_attributes);
-	if (g->node_attributes!=NULL)
-		fprintf(out, "    classDef node %s\n", g->node_attributes);
-	if (g->edge_attributes!=NULL)
-		fprintf(out, "    linkStyle default %s\n", g->edge_attributes);
-	if (g->dirty_attributes != NULL)
-		fprintf(out, "    classDef dirty %s\n", g->dirty_attributes);
-
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root ) continue;
-		
-		if(t==g->root)
-			fprintf(out,"    n%zu{ }\n",t->id);
-		else
-			{
-			const char* label=targetLabel(g,t->name);
-			if (t->must_remake)
-				fprintf(out,"    n%zu{{\"", t->id);
-			else
-				fprintf(out,"    n%zu(\"", t->id);
-			while(*label)
-				{
-				if(*label=='\"')
-					fputs("\\\"",out);
-				else
-					fputc(*label,out);
-				label++;
-				}
-			if (t->must_remake)
-				fputs("\"}}:::dirty\n", out);
-			else
-				fputs("\")\n", out);
-			}
-		}
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root) continue;
-		
-		for(j=0; j< t->n_children; ++j)
-			{
-			TargetPtr c = t->children[j];
-			fprintf(out,"    n%zu --> n%zu\n", c->id, t->id);
-			}
-		}
-	}
-
-/** export a PlantUML state diagram */
-static void DumpGraphAsPlantUML(GraphPtr g,FILE* out)
-	{
-	size_t i=0,j=0;
-
-	fputs("@startuml\n\nhide empty description\n\n", out);
-	if (g->colorscheme != NULL)
-		fprintf(out, "!theme%s\n", g->colorscheme);
-
-	if (g->graph_attributes!=NULL)
-		fprintf(out, "' graph attributes\n%s\n\n", g->graph_attributes);
-	if (g->node_attributes!=NULL)
-		fprintf(out, "skinparam state {\n  %s\n}\n\n", g->node_attributes);
-	if (g->dirty_attributes != NULL)
-		fprintf(out, "skinparam state<<dirty>> {\n  %s\n}\n\n", g->dirty_attributes);
-
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( g->show_root && t==g->root )
-			{
-			fputs("state \" \" as root {\n", out);
-			if (g->edge_attributes != NULL)
-				fprintf(out, "    ' edge attributes\n    %s\n\n", g->edge_attributes);
-			}
-		else
-			{
-			fputs("    state \"", out);
-			const char* label=targetLabel(g, t->name);
-			while(*label)
-				{
-				if(*label=='\"')
-					fputs("\\\"",out);
-				else
-					fputc(*label,out);
-				label++;
-				}
-			if (t->must_remake)
-				fprintf(out,"\" as n%zu <<dirty>>\n", t->id);
-			else
-				fprintf(out,"\" as n%zu <<node>>\n", t->id);
-			}
-		}
-	fputs("\n", out);
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root) continue;
-		
-		for(j=0; j< t->n_children; ++j)
-			{
-			TargetPtr c = t->children[j];
-			if (t->id == 1)
-				fprintf(out,"    [*] --> n%zu\n", c->id);
-			else
-				fprintf(out,"    n%zu --> n%zu\n", t->id , c->id);
-			}
-		}
-	if( g->show_root )
-		fputs("}\n", out);
-	fputs("@enduml\n\n", out);
-	}
-
-/** export a Gephi / Gexf */
-static void DumpGraphAsGexf(GraphPtr g,FILE* out)
+/** feed the graph with the content of the file descriptor */
+static int GraphScanFd(GraphPtr g,int fd)
 	{
-	size_t i=0,j=0,k=0UL;
-	fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n",out);
-	fputs("<gexf xmlns=\"http://www.gexf.net/1.2draft\" version=\"1.2\">\n",out);
-	fputs("  <meta>\n",out);
-	fputs("    <creator>https://github.com/lindenb/makefile2graph version:" M2G_VERSION "</creator>\n",out);
-	fputs("    <description>Creates a graph from a Makefile</description>\n",out);
-	fputs("  </meta>\n",out);
-	fputs("  <graph mode=\"static\" defaultedgetype=\"directed\">\n",out);
-	fputs("    <attributes class=\"node\" mode=\"static\"/>\n",out);
-	fputs("    <nodes>\n",out);
-	for(i=0; i< g->target_count; ++i)
+	char buf[65536];
+	ssize_t n;
+	while(!GraphFeedDone(g))
 		{
-		j=0UL;
-		TargetPtr t= g->targets[i];
-		const char* label=targetLabel(g,t->name);
-		if( !g->show_root && t==g->root ) continue;
-		
-		fprintf(out,
-			"      <node id=\"n%zu\" label=\"", t->id);
-		while(label[j]!=0)
+		double left=GraphTimeLeft(g);
+		/* a blocked read would not see the timeout */
+		if(left>0)
 			{
-			switch(t->name[j])
-				{
-				case '<': fputs("&lt;",out);break;
-				case '>': fputs("&gt;",out);break;
-				case '\"': fputs("&apos;",out);break;
-				case '\'': fputs("&quot;",out);break;
-				case '&': fputs("&amp;",out);break;
-				default: fputc(label[j],out);break;
-				}
-			++j;
+			struct pollfd p={fd,POLLIN,0};
+			int r=poll(&p,1,(int)(left*1000)+1);
+			if(r==0 || (r<0 && errno==EINTR)) continue;
 			}
-		fputs("\"/>\n",out);
-		}
-	fputs("    </nodes>\n",out);
-	fputs("    <edges>\n",out);
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		if( !g->show_root && t==g->root ) continue;
-		
-		for(j=0; j< t->n_children; ++j)
+		else if(left==0) break;
+		n=read(fd,buf,sizeof(buf));
+		if(n==0) break;
+		if(n<0)
 			{
-			TargetPtr c = t->children[j];
-			fprintf(out,
-				"      <edge id=\"E%zu\" type=\"directed\" source=\"n%zu\" target=\"n%zu\"/>\n",
-				++k,c->id , t->id);
+			if(errno==EINTR) continue;
+			fprintf(stderr,"Cannot read input : \"%s\".\n",strerror(errno));
+			return -1;
 			}
-		}
-	fputs("    </edges>\n",out);
-	fputs("  </graph>\n",out);
-	fputs("</gexf>\n",out);
-	fflush(out);
-	}
-	
-/** for deep output , recursively look the targets to check is they're 'deep' */
-static int IsDeepFlag(GraphPtr g,const TargetPtr t,int depth)
-	{
-	int dirty_children=0;
-	size_t j;
-	/* test if children must be remake */
-	for(j=0; j< t->n_children; ++j)
-		{
-		TargetPtr c = t->children[j];
-		/* test if one CHILDREN must be rebuilt */
-		if(IsDeepFlag(g,c,depth+1))
+		if(GraphFeed(g,buf,(size_t)n)!=0)
 			{
-			dirty_children=1;
-			break;
+			fprintf(stderr,"%s\n",GraphError(g));
+			return -1;
 			}
 		}
-	/** depth is 0 */
-	if(depth==0)
-		{
-		/** any dirty children ? */
-		if( dirty_children==1) return 0;
-		return t->must_remake;
-		}
-	return t->must_remake || dirty_children;
-	}
-
-/** print a list of independant deep targets */
-static void DumpGraphAsDeep(GraphPtr g,FILE* out)
-	{
-	size_t i=0;
-	for(i=0; i< g->target_count; ++i)
+	if(GraphFeedEnd(g)!=0)
 		{
-		TargetPtr t= g->targets[i];
-		if(!IsDeepFlag(g,t,0)) continue;
-		fputs(t->name,out);
-		fputc('\n',out);
+		fprintf(stderr,"%s\n",GraphError(g));
+		return -1;
 		}
+	return 0;
 	}
 
-/** print a list of targets */
-static void DumpGraphAsList(GraphPtr g,FILE* out)
-	{
-	size_t i=0;
-	for(i=0; i< g->target_count; ++i)
-		{
-		TargetPtr t= g->targets[i];
-		fputs(t->name,out);
-		fputc('\n',out);
-		}
-	}
-
-
 /** print usage */
 static void usage(FILE* out)
 	{
@@ -688,14 +99,24 @@ static void usage(FILE* out)
 	fputs("\t\t(g)exf XML output (M)ermaid output (P)lantUML output\n",out);
 	fputs("\t\t(E) print the deepest indepedent targets.\n",out);
 	fputs("\t\t(L)ist all targets.\n",out);
+	fputs("\t\t(J)SON lines, one object per node and per edge.\n",out);
+	fputs("\t\t(B)inary little-endian CSR arrays, see make2graph.h.\n",out);
+	fputs("\t\t(S)CC: report the cycles, self-edges and unreachable targets.\n",out);
 	fputs("\t-b|--basename only print file basename.\n",out);
 	fputs("\t-s|--suffix only print file extension.\n",out);
 	fputs("\t-r|--root show <ROOT> node.\n",out);
+	fputs("\t-C|--condense condense each cycle into a single node.\n",out);
 	fputs("\t-c|--colorscheme (scheme) Set colorscheme applied interleaved to all nodes.\n", out);
 	fputs("\t-g|--graph-attributes: Sets attributes applied to the graph.\n", out);
 	fputs("\t-n|--node-attributes: Sets attributes applied to all nodes.\n", out);
 	fputs("\t-e|--edge-attributes: Sets attributes applied to all edges.\n", out);
 	fputs("\t-e|--dirty-attributes: Sets attributes applied to dirty nodes only.\n", out);
+	fprintf(out,"\t-j|--threads (n) number of threads used to render the output (at most %d).\n",MAX_RENDER_THREADS);
+	fputs("\t-M|--max-nodes (n) stop reading the input after (n) targets.\n", out);
+	fputs("\t-D|--max-depth (n) skip the targets deeper than (n).\n", out);
+	fputs("\t-T|--timeout (seconds) stop reading the input after (seconds).\n", out);
+	fputs("\t-S|--serve (socket) keep the graph in memory and answer queries on a unix socket.\n", out);
+	fputs("\t-W|--watch (dir) with --serve, watch the files of the graph and run `make -nd` in (dir) when a makefile changes.\n", out);
 	fputs("\t-v|--version print version.\n", out);
 	fputs("Notes:\n", out);
 	fputs("\tAttributes require arguments in the form: name1=value1,...\n", out);
@@ -705,15 +126,16 @@ static void usage(FILE* out)
 int main(int argc,char** argv)
 	{
 	int out_format = output_dot;
-	int print_basename_only=0;
-	int print_suffix_only=0;
-	char *colorscheme=NULL;
-	char *graph_attributes = NULL;
-	char *node_attributes = NULL;
-	char *edge_attributes = NULL;
-	char *dirty_attributes = NULL;
-	int show_root=0;
+	GraphOptions opts;
+	int out_fd = STDOUT_FILENO;
+	GraphSink sink = { GraphSinkFdWrite, &out_fd };
 	GraphPtr app=NULL;
+	char* serve_socket=NULL;
+	char* watch_dir=NULL;
+	int condense=0;
+	GraphAnalysis analysis;
+	int ret;
+	GraphOptionsInit(&opts);
 	for(;;)
 		{
 		static struct option long_options[] =
@@ -723,16 +145,23 @@ int main(int argc,char** argv)
 			{"basename",   no_argument, 0, 'b'},
 			{"suffix",   no_argument, 0, 's'},
 			{"root",   no_argument, 0, 'r'},
+			{"condense",   no_argument, 0, 'C'},
 		    {"colorscheme",      required_argument ,0, 'c'},
 		    {"graph-attributes", required_argument ,0, 'g'},
 		    {"node-attributes",  required_argument ,0, 'n'},
 		    {"edge-attributes",  required_argument ,0, 'e'},
 		    {"dirty-attributes",  required_argument ,0, 'd'},
+		    {"threads",  required_argument ,0, 'j'},
+		    {"max-nodes",  required_argument ,0, 'M'},
+		    {"max-depth",  required_argument ,0, 'D'},
+		    {"timeout",  required_argument ,0, 'T'},
+		    {"serve",  required_argument ,0, 'S'},
+		    {"watch",  required_argument ,0, 'W'},
 			{"version",   no_argument, 0, 'v'},
 		       {0, 0, 0, 0}
 		     };
 		int option_index = 0;
-		int c = getopt_long (argc, argv, "hbsrvf:c:g:n:e:d:",
+		int c = getopt_long (argc, argv, "hbsrCvf:c:g:n:e:d:j:M:D:T:S:W:",
 		                    long_options, &option_index);
 		if (c == -1) break;
 		switch (c)
@@ -740,33 +169,71 @@ int main(int argc,char** argv)
 			case 'v': printf("%s\n",M2G_VERSION); return EXIT_SUCCESS;
 			case 'f':
 				{
-				switch(optarg[0])
+				out_format = GraphParseFormat(optarg);
+				if(out_format<0)
 					{
-					case 'x':case 'X': 
-					case 'g':case 'G': out_format = output_gexf; break;
-					case 'm':case 'M': out_format = output_mermaid; break;
-					case 'p':case 'P': out_format = output_plantuml; break;
-					case 'd':case 'D': out_format = output_dot; break;
-					case 'e':case 'E': out_format = output_deep; break;
-					case 'l':case 'L': out_format = output_list; break;
-					default:
-						{
-						fprintf(stderr,"Bad value for --format=%s\n",optarg);
-						return EXIT_FAILURE;
-						break;
-						}
+					fprintf(stderr,"Bad value for --format=%s\n",optarg);
+					return EXIT_FAILURE;
 					}
 				break;
 				}
 		   	case 'h': usage(stdout); return EXIT_SUCCESS;
-			case 'b': print_basename_only=1; break;
-			case 's': print_suffix_only=1; break;
-			case 'r': show_root=1; break;
-			case 'c': colorscheme=optarg; break;
-			case 'g': graph_attributes=optarg; break;
-			case 'n': node_attributes=optarg; break;
-			case 'e': edge_attributes=optarg; break;
-			case 'd': dirty_attributes=optarg; break;
+			case 'b': opts.print_basename_only=1; break;
+			case 's': opts.print_suffix_only=1; break;
+			case 'r': opts.show_root=1; break;
+			case 'C': condense=1; break;
+			case 'c': opts.colorscheme=optarg; break;
+			case 'g': opts.graph_attributes=optarg; break;
+			case 'n': opts.node_attributes=optarg; break;
+			case 'e': opts.edge_attributes=optarg; break;
+			case 'd': opts.dirty_attributes=optarg; break;
+			case 'j':
+				{
+				char* p;
+				unsigned long n=strtoul(optarg,&p,10);
+				if(*p!=0 || n<1 || n>MAX_RENDER_THREADS)
+					{
+					fprintf(stderr,"Bad value for --threads=%s (1-%d)\n",optarg,MAX_RENDER_THREADS);
+					return EXIT_FAILURE;
+					}
+				opts.threads=(int)n;
+				break;
+				}
+			case 'M':
+				{
+				char* p;
+				opts.max_nodes=strtoul(optarg,&p,10);
+				if(*p!=0 || opts.max_nodes<1)
+					{
+					fprintf(stderr,"Bad value for --max-nodes=%s\n",optarg);
+					return EXIT_FAILURE;
+					}
+				break;
+				}
+			case 'D':
+				{
+				char* p;
+				opts.max_depth=strtoul(optarg,&p,10);
+				if(*p!=0 || opts.max_depth<1)
+					{
+					fprintf(stderr,"Bad value for --max-depth=%s\n",optarg);
+					return EXIT_FAILURE;
+					}
+				break;
+				}
+			case 'T':
+				{
+				char* p;
+				opts.timeout=strtod(optarg,&p);
+				if(*p!=0 || !(opts.timeout>0))
+					{
+					fprintf(stderr,"Bad value for --timeout=%s\n",optarg);
+					return EXIT_FAILURE;
+					}
+				break;
+				}
+			case 'S': serve_socket=optarg; break;
+			case 'W': watch_dir=optarg; break;
    	        default:
 				fprintf(stderr, "Unknown option `-%c' at %d: %s\n", 
 					optopt, optind-1, argv[optind-1]);
@@ -775,69 +242,68 @@ int main(int argc,char** argv)
 		  
 		}
 	
-	
-	app=(GraphPtr)calloc(1,sizeof(Graph));
-	
-	if(app==NULL)
+	if(watch_dir!=NULL && serve_socket==NULL)
+		{
+		fprintf(stderr,"--watch requires --serve.\n");
+		return EXIT_FAILURE;
+		}
+	if(condense && serve_socket!=NULL)
 		{
-		fputs("OUT OF MEMORY\n",stderr);
-		exit(EXIT_FAILURE);
+		fprintf(stderr,"--condense cannot be used with --serve.\n");
+		return EXIT_FAILURE;
 		}
 	
-	app-> print_basename_only =  print_basename_only ;
-	app-> print_suffix_only =  print_suffix_only ;
-	app-> show_root = show_root;
-	app-> colorscheme = colorscheme;
-	app-> graph_attributes = graph_attributes;
-	app-> node_attributes = node_attributes;
-	app-> edge_attributes = edge_attributes;
-	app-> dirty_attributes = dirty_attributes;
+	app=GraphNew(&opts);
 
-	app->root=GraphGetTarget(app,"<ROOT>");
 	if(optind==argc)
 		{
-		GraphScan(app,app->root,stdin,0);
+		ret=GraphScanFd(app,STDIN_FILENO);
 		}
 	else if(optind+1==argc)
 		{
-		FILE* in=fopen(argv[optind],"r");
-		if(in==NULL)
+		int in=open(argv[optind],O_RDONLY);
+		if(in<0)
 			{
 			fprintf(stderr,"Cannot open \"%s\" : \"%s\".\n",argv[optind],strerror(errno));
 			return EXIT_FAILURE;
 			}
-		GraphScan(app,app->root,in,0);
-		fclose(in);
+		ret=GraphScanFd(app,in);
+		close(in);
 		}
 	else
 		{
 		fprintf(stderr,"Illegal number of arguments.\n");
 		return EXIT_FAILURE;
 		}
-	switch(out_format)
+	if(ret!=0)
+		{
+		GraphFree(app);
+		return EXIT_FAILURE;
+		}
+	if(GraphTruncated(app)!=NULL)
+		{
+		fprintf(stderr,"[make2graph] input truncated: %s.\n",GraphTruncated(app));
+		}
+	GraphAnalysisInit(&analysis);
+	GraphAnalyze(app,&analysis);
+	if(analysis.cycle_count>0 || analysis.self_edge_count>0)
+		{
+		fprintf(stderr,"[make2graph] %lu cycle(s) and %lu self-edge(s) found, see --format scc.\n",
+			(unsigned long)analysis.cycle_count,
+			(unsigned long)analysis.self_edge_count);
+		}
+	if(condense)
+		{
+		GraphPtr condensed=GraphCondense(app);
+		GraphFree(app);
+		app=condensed;
+		}
+	if(serve_socket!=NULL)
 		{
-		case output_gexf : 
-			DumpGraphAsGexf(app,stdout);
-			break;
-		case output_mermaid:
-			DumpGraphAsMermaid(app, stdout);
-			break;
-		case output_plantuml:
-			DumpGraphAsPlantUML(app, stdout);
-			break;
-		case output_deep:
-			DumpGraphAsDeep(app,stdout);
-			break;
-		case output_list : 
-			DumpGraphAsList(app,stdout);
-			break;
-		case output_dot : 
-		default:
-			DumpGraphAsDot(app,stdout);
-			break;
-		
+		return GraphServe(app,&opts,serve_socket,watch_dir)==0 ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-	free(app);
+	ret=GraphDump(app,out_format,&sink);
+	GraphFree(app);
 	
-	return EXIT_SUCCESS;
+	return ret==0 ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
@@ -0,0 +1,290 @@
+/* The MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+
+   contact: Pierre Lindenbaum PhD @yokofakun
+
+   libmake2graph: parses the output of `make -nd` and dumps the
+   graph of dependencies.
+
+   Typical use:
+
+	GraphOptions opts;
+	GraphOptionsInit(&opts);
+	GraphPtr g = GraphNew(&opts);
+	while( (n = read(fd, buf, sizeof(buf))) > 0 )
+		if( GraphFeed(g, buf, n) != 0 ) error(GraphError(g));
+	GraphFeedEnd(g);
+	GraphSink sink = { GraphSinkFileWrite, stdout };
+	DumpGraphAsDot(g, &sink);
+	GraphFree(g);
+*/
+#ifndef MAKE2GRAPH_H
+#define MAKE2GRAPH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* version */
+#define M2G_VERSION "1.5.0"
+
+/** output formats understood by GraphDump */
+enum output_type {
+	output_dot,
+	output_gexf,
+	output_mermaid,
+	output_plantuml,
+	output_deep,
+	output_list,
+	output_jsonl,
+	output_bin,
+	output_scc
+	};
+
+/** first bytes of the binary output, see DumpGraphAsBinary */
+#define BINARY_MAGIC "M2GBIN\0\0"
+/** version of the binary output */
+#define BINARY_VERSION 1
+/** size of the header of the binary output */
+#define BINARY_HEADER_SIZE 96
+/** node flag of the binary output: target must be remade */
+#define BINARY_FLAG_DIRTY 1
+/** node flag of the binary output: the <ROOT> node */
+#define BINARY_FLAG_ROOT 2
+/** header flag of the binary output: the input was not fully parsed, see GraphTruncated */
+#define BINARY_FLAG_TRUNCATED 1
+
+/** maximum number of threads used to render the output, see GraphOptions */
+#define MAX_RENDER_THREADS 256
+
+/** a Target (opaque) */
+typedef struct target_t Target,*TargetPtr;
+
+/** the Makefile graph (opaque) */
+typedef struct make2graph_t Graph,*GraphPtr;
+
+/** options of a graph, fixed at creation time. New fields are only appended, so the callers
+ * built against an older make2graph.h still work: always fill it with GraphOptionsInit */
+typedef struct graph_options_t
+	{
+	/** sizeof(GraphOptions) of the caller, set by GraphOptionsInit */
+	size_t struct_size;
+	/** flag print only basename */
+	int print_basename_only;
+	/** flag print only extension */
+	int print_suffix_only;
+	/** show <root> node https://github.com/lindenb/makefile2graph/issues/3 */
+	int show_root;
+	/** sets colorscheme applied interleaved to all nodes */
+	const char *colorscheme;
+	/** sets attributes applied to the graph */
+	const char *graph_attributes;
+	/** sets attributes applied to all nodes */
+	const char *node_attributes;
+	/** sets attributes applied to all edges */
+	const char *edge_attributes;
+	/** sets attributes applied to dirty nodes only */
+	const char *dirty_attributes;
+	/** number of threads used to render the output, 0 or 1 for a single thread, at most MAX_RENDER_THREADS */
+	int threads;
+	/** stop parsing after this number of targets, 0 for no limit */
+	size_t max_nodes;
+	/** skip the targets deeper than this, 0 for no limit */
+	size_t max_depth;
+	/** stop parsing after this number of seconds, 0 for no limit */
+	double timeout;
+	}GraphOptions,*GraphOptionsPtr;
+
+/** where the DumpGraphAs* functions write their output */
+typedef struct graph_sink_t
+	{
+	/** write 'len' bytes of 'data', returns 0 on success */
+	int (*write)(void* ctx,const char* data,size_t len);
+	/** user data passed to write */
+	void* ctx;
+	}GraphSink,*GraphSinkPtr;
+
+/** result of GraphAnalyze. As GraphOptions, new fields are only appended: fill it with GraphAnalysisInit */
+typedef struct graph_analysis_t
+	{
+	/** sizeof(GraphAnalysis) of the caller, set by GraphAnalysisInit */
+	size_t struct_size;
+	/** number of strongly connected components */
+	size_t component_count;
+	/** number of components made of more than one target */
+	size_t cycle_count;
+	/** number of targets depending on themselves */
+	size_t self_edge_count;
+	/** number of targets that cannot be reached from <ROOT> */
+	size_t unreachable_count;
+	}GraphAnalysis,*GraphAnalysisPtr;
+
+/** a sink writer for a FILE* given as 'ctx' */
+int GraphSinkFileWrite(void* ctx,const char* data,size_t len);
+
+/** a sink writer for a file descriptor, 'ctx' is a pointer to the int */
+int GraphSinkFdWrite(void* ctx,const char* data,size_t len);
+
+/** fills the options with the default values and sets struct_size */
+void GraphOptionsInit(GraphOptionsPtr opts);
+
+/** creates a new empty graph, 'opts' may be NULL. The strings in 'opts' are copied.
+ * The fields beyond opts->struct_size keep their default value. returns NULL if struct_size was not set */
+GraphPtr GraphNew(const GraphOptions* opts);
+
+/** release the graph and all its targets */
+void GraphFree(GraphPtr g);
+
+/** push a chunk of the `make -nd` output to the parser. Lines may span several chunks.
+ * returns 0 on success, -1 on a parse error (see GraphError) */
+int GraphFeed(GraphPtr g,const char* bytes,size_t len);
+
+/** signals the end of the input, parses any pending incomplete line and sorts the targets by name.
+ * returns 0 on success. */
+int GraphFeedEnd(GraphPtr g);
+
+/** convenience: feeds the whole content of 'in' and calls GraphFeedEnd. returns 0 on success. */
+int GraphScanFile(GraphPtr g,FILE* in);
+
+/** last error message or NULL */
+const char* GraphError(const Graph* g);
+
+/** NULL if the whole input was parsed, otherwise the budget (max_nodes, max_depth, timeout) that was reached */
+const char* GraphTruncated(const Graph* g);
+
+/** returns 1 if the parser ignores any further input (e.g. a node or time budget was reached), the caller can stop reading */
+int GraphFeedDone(const Graph* g);
+
+/** seconds left before the --timeout, negative if there is no timeout. The caller should not wait longer
+ * for the input. Once the time is over, returns 0, the input is marked as truncated and GraphFeedDone returns 1 */
+double GraphTimeLeft(GraphPtr g);
+
+/** number of targets, including the <ROOT> target */
+size_t GraphTargetCount(const Graph* g);
+
+/** i-th target, targets are sorted by name once GraphFeedEnd returned */
+TargetPtr GraphTargetAt(const Graph* g,size_t i);
+
+/** the <ROOT> target */
+TargetPtr GraphRoot(const Graph* g);
+
+/** find a target by name, returns NULL if it doesn't exist */
+TargetPtr GraphFindTarget(const Graph* g,const char* name);
+
+/** number of makefiles read by make */
+size_t GraphMakefileCount(const Graph* g);
+
+/** i-th makefile read by make */
+const char* GraphMakefileAt(const Graph* g,size_t i);
+
+/** marks all the targets depending on 't' as dirty. returns the number of targets that changed */
+size_t GraphInvalidate(GraphPtr g,TargetPtr t);
+
+/** marks all the targets depending on any of the 'count' targets as dirty, in a single pass.
+ * the reverse edges are cached in the graph. returns the number of targets that changed */
+size_t GraphInvalidateTargets(GraphPtr g,TargetPtr* targets,size_t count);
+
+/** creates a new graph made of 't' and all its prerequisites, under a new <ROOT>.
+ * the ids of the targets are preserved. */
+GraphPtr GraphFocus(const Graph* g,const Target* t);
+
+/** zeroes the analysis and sets struct_size */
+void GraphAnalysisInit(GraphAnalysisPtr a);
+
+/** finds the strongly connected components of the graph (iterative, linear in the number of
+ * targets and edges) and counts the cycles, the self-edges and the unreachable targets.
+ * Only the fields within a->struct_size are written. returns -1 if struct_size was not set */
+int GraphAnalyze(GraphPtr g,GraphAnalysisPtr a);
+
+/** creates a new graph where each cycle is condensed into a single target, named after its first
+ * target, e.g. "a.o (+2)". The new graph has no cycle. The ids of the targets are preserved. */
+GraphPtr GraphCondense(GraphPtr g);
+
+/** target id, unique in the graph */
+size_t TargetId(const Target* t);
+
+/** copy the target name in 'buf' (at most 'size' bytes, including the final '\0')
+ * returns the length of the full name, as snprintf does */
+size_t TargetName(const Target* t,char* buf,size_t size);
+
+/** is the target dirty */
+int TargetMustRemake(const Target* t);
+
+/** depth of the target when it was first seen as a prerequisite */
+size_t TargetLevel(const Target* t);
+
+/** number of prerequisites */
+size_t TargetChildCount(const Target* t);
+
+/** i-th prerequisite, sorted by name */
+TargetPtr TargetChildAt(const Target* t,size_t i);
+
+/** parse a --format value, returns -1 if it is not a known format */
+int GraphParseFormat(const char* s);
+
+/** dump the graph in the given output_type. All the Dump* functions return 0 on success, -1 if the sink failed */
+int GraphDump(GraphPtr g,int format,GraphSinkPtr sink);
+/** export a graphiz dot */
+int DumpGraphAsDot(GraphPtr g,GraphSinkPtr sink);
+/** export a mermaid flowchart */
+int DumpGraphAsMermaid(GraphPtr g,GraphSinkPtr sink);
+/** export a PlantUML state diagram */
+int DumpGraphAsPlantUML(GraphPtr g,GraphSinkPtr sink);
+/** export a Gephi / Gexf */
+int DumpGraphAsGexf(GraphPtr g,GraphSinkPtr sink);
+/** print a list of independant deep targets */
+int DumpGraphAsDeep(GraphPtr g,GraphSinkPtr sink);
+/** print a list of targets */
+int DumpGraphAsList(GraphPtr g,GraphSinkPtr sink);
+/** report of the cycles, self-edges and unreachable targets, one per line, tab-separated */
+int DumpGraphAsScc(GraphPtr g,GraphSinkPtr sink);
+/** JSON lines: one object per node then one object per edge */
+int DumpGraphAsJsonLines(GraphPtr g,GraphSinkPtr sink);
+/** little-endian binary dump, all the sections are aligned on 8 bytes:
+ *
+ *	header (BINARY_HEADER_SIZE bytes):
+ *		char     magic[8]        BINARY_MAGIC
+ *		uint32   version         BINARY_VERSION
+ *		uint32   flags           BINARY_FLAG_TRUNCATED
+ *		uint64   node_count      n
+ *		uint64   edge_count      e
+ *		uint64   strings_size    size of the string table
+ *		uint64   sections[7]     offset of each section in the file
+ *	sections:
+ *		uint64   ids[n]          target ids, as in the other formats
+ *		uint64   names[n+1]      name of node i is strings[names[i]] (NUL-terminated)
+ *		uint32   flags[n]        BINARY_FLAG_DIRTY | BINARY_FLAG_ROOT
+ *		uint32   depth[n]        level of the target
+ *		uint64   row[n+1]        prerequisites of node i are edges[row[i]..row[i+1]-1] (CSR)
+ *		uint64   edges[e]        node indexes
+ *		char     strings[strings_size]
+ */
+int DumpGraphAsBinary(GraphPtr g,GraphSinkPtr sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,760 @@
+/* The MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+
+   contact: Pierre Lindenbaum PhD @yokofakun
+
+   make2graph --serve SOCKET [--watch DIR]
+
+   One request per connection, a single line:
+
+	list                  all the targets
+	dirty                 the targets that must be remade
+	dump [FORMAT]         the whole graph
+	focus FORMAT TARGET   TARGET and its prerequisites
+	retrace               run `make -nd` again in DIR
+
+   FORMAT is any value of --format. Errors are answered as "error: message".
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "serve.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
+
+#define OUT_OF_MEMORY do { fprintf(stderr,"%s: %d : OUT_OF_MEMORY.\n",__FILE__,__LINE__); exit(EXIT_FAILURE);} while(0)
+
+/** make compares the mtimes: IN_ATTRIB catches a file only touched (touch -d, cp -p, rsync -t, tar...) */
+#define WATCH_EVENTS (IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_CREATE|IN_DELETE|IN_ATTRIB)
+
+/** seconds without progress before a client is disconnected */
+#define CLIENT_TIMEOUT 5.0
+/** maximum number of clients connected at the same time, the others wait in the backlog */
+#define MAX_CLIENTS 64
+/** seconds without new change of a target before it is traced again, a build rewrites many files */
+#define RETRACE_DELAY 0.5
+
+/** a connected client */
+typedef struct client_t
+	{
+	int fd;
+	/** request being read */
+	char request[BUFSIZ];
+	size_t request_len;
+	/** answer being sent, NULL while the request is read */
+	char* answer;
+	size_t answer_len;
+	size_t answer_capacity;
+	/** bytes of the answer already sent */
+	size_t answer_sent;
+	/** the client is disconnected if it makes no progress until this time (see ServerNow) */
+	double deadline;
+	}Client,*ClientPtr;
+
+/** a file of the graph */
+typedef struct watched_file_t
+	{
+	/** path of the file, relative to the current directory */
+	char* path;
+	/** name of the target in the graph */
+	char* name;
+	/** the file is a makefile */
+	int is_makefile;
+	}WatchedFile,*WatchedFilePtr;
+
+/** a directory watched with inotify */
+typedef struct watched_dir_t
+	{
+	int wd;
+	char* path;
+	}WatchedDir,*WatchedDirPtr;
+
+/** the state of the server */
+typedef struct server_t
+	{
+	/** current graph */
+	GraphPtr graph;
+	/** options used to create a new graph */
+	const GraphOptions* opts;
+	/** directory where make is run, or NULL */
+	const char* watch_dir;
+	/** inotify file descriptor or -1 */
+	int inotify_fd;
+	/** files of the graph, sorted by path */
+	WatchedFilePtr files;
+	size_t file_count;
+	/** watched directories */
+	WatchedDirPtr dirs;
+	size_t dir_count;
+	/** graph being built by a background `make -nd` */
+	GraphPtr next_graph;
+	/** stdout of the background make, or -1 */
+	int retrace_fd;
+	/** pid of the background make */
+	pid_t retrace_pid;
+	/** a retrace was requested while another one was running */
+	int retrace_pending;
+	/** time of the next debounced retrace (see ServerNow), 0 if none */
+	double retrace_at;
+	/** connected clients */
+	ClientPtr clients;
+	size_t client_count;
+	}Server,*ServerPtr;
+
+static volatile sig_atomic_t server_stop=0;
+
+static void ServerSignal(int sig)
+	{
+	server_stop=1;
+	}
+
+/** seconds elapsed since an arbitrary point in the past */
+static double ServerNow(void)
+	{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec + ts.tv_nsec/1.0E9;
+	}
+
+static char* ServerStrDup(const char* s)
+	{
+	char* p=strdup(s);
+	if(p==NULL) OUT_OF_MEMORY;
+	return p;
+	}
+
+/** returns dir/name, or name if it is absolute or dir is NULL */
+static char* ServerJoin(const char* dir,const char* name)
+	{
+	char* p;
+	size_t len;
+	if(dir==NULL || name[0]=='/') return ServerStrDup(name);
+	len=strlen(dir);
+	p=(char*)malloc(len+strlen(name)+2);
+	if(p==NULL) OUT_OF_MEMORY;
+	/* don't double the slash of "/" */
+	sprintf(p,"%s%s%s",dir,(len>0 && dir[len-1]=='/'?"":"/"),name);
+	return p;
+	}
+
+static int WatchedFileCmp(const void* a,const void* b)
+	{
+	return strcmp(((WatchedFilePtr)a)->path,((WatchedFilePtr)b)->path);
+	}
+
+/** forget all the watches */
+static void ServerUnwatch(ServerPtr s)
+	{
+	size_t i;
+	for(i=0;i< s->file_count;++i)
+		{
+		free(s->files[i].path);
+		free(s->files[i].name);
+		}
+	free(s->files);
+	s->files=NULL;
+	s->file_count=0UL;
+	for(i=0;i< s->dir_count;++i) free(s->dirs[i].path);
+	free(s->dirs);
+	s->dirs=NULL;
+	s->dir_count=0UL;
+	if(s->inotify_fd>=0) close(s->inotify_fd);
+	s->inotify_fd=-1;
+	}
+
+/** add a file to the list of watched files */
+static void ServerAddFile(ServerPtr s,const char* name,int is_makefile)
+	{
+	WatchedFilePtr f;
+	s->files=(WatchedFilePtr)realloc(s->files,sizeof(WatchedFile)*(s->file_count+1));
+	if(s->files==NULL) OUT_OF_MEMORY;
+	f=&s->files[s->file_count++];
+	f->path=ServerJoin(s->watch_dir,name);
+	f->name=ServerStrDup(name);
+	f->is_makefile=is_makefile;
+	}
+
+/** watch the directory containing 'path' */
+static void ServerWatchDir(ServerPtr s,const char* path)
+	{
+	size_t i;
+	int wd;
+	char* dir=ServerStrDup(path);
+	char* slash=strrchr(dir,'/');
+	/* 'path' always contains the watched directory */
+	if(slash==NULL)
+		{
+		free(dir);
+		return;
+		}
+	if(slash==dir) slash[1]=0;
+	else *slash=0;
+	wd=inotify_add_watch(s->inotify_fd,dir,WATCH_EVENTS);
+	if(wd<0)
+		{
+		/* directory doesn't exist yet, e.g. a build directory */
+		free(dir);
+		return;
+		}
+	for(i=0;i< s->dir_count;++i)
+		{
+		if(s->dirs[i].wd==wd)
+			{
+			free(dir);
+			return;
+			}
+		}
+	s->dirs=(WatchedDirPtr)realloc(s->dirs,sizeof(WatchedDir)*(s->dir_count+1));
+	if(s->dirs==NULL) OUT_OF_MEMORY;
+	s->dirs[s->dir_count].wd=wd;
+	s->dirs[s->dir_count].path=dir;
+	s->dir_count++;
+	}
+
+/** (re)create the watches for the files of the current graph */
+static int ServerWatch(ServerPtr s)
+	{
+	size_t i,n;
+	char* name=NULL;
+	size_t name_size=0UL;
+	ServerUnwatch(s);
+	if(s->watch_dir==NULL) return 0;
+	s->inotify_fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	if(s->inotify_fd<0)
+		{
+		fprintf(stderr,"inotify_init failed : \"%s\".\n",strerror(errno));
+		return -1;
+		}
+	for(i=0;i< GraphMakefileCount(s->graph);++i)
+		{
+		ServerAddFile(s,GraphMakefileAt(s->graph,i),1);
+		}
+	for(i=0;i< GraphTargetCount(s->graph);++i)
+		{
+		TargetPtr t=GraphTargetAt(s->graph,i);
+		size_t j;
+		if(t==GraphRoot(s->graph)) continue;
+		n=TargetName(t,name,name_size);
+		if(n>=name_size)
+			{
+			name_size=n+1;
+			name=(char*)realloc(name,name_size);
+			if(name==NULL) OUT_OF_MEMORY;
+			TargetName(t,name,name_size);
+			}
+		/* with --root, the makefiles are also targets */
+		for(j=0;j< GraphMakefileCount(s->graph);++j)
+			{
+			if(strcmp(GraphMakefileAt(s->graph,j),name)==0) break;
+			}
+		if(j< GraphMakefileCount(s->graph)) continue;
+		ServerAddFile(s,name,0);
+		}
+	free(name);
+	qsort(s->files,s->file_count,sizeof(WatchedFile),WatchedFileCmp);
+	for(i=0;i< s->file_count;++i)
+		{
+		ServerWatchDir(s,s->files[i].path);
+		}
+	return 0;
+	}
+
+/** starts `make -nd` in the background */
+static void ServerRetrace(ServerPtr s)
+	{
+	int fds[2];
+	pid_t pid;
+	if(s->watch_dir==NULL) return;
+	if(s->retrace_fd>=0)
+		{
+		s->retrace_pending=1;
+		return;
+		}
+	if(pipe(fds)!=0)
+		{
+		fprintf(stderr,"pipe failed : \"%s\".\n",strerror(errno));
+		return;
+		}
+	pid=fork();
+	if(pid<0)
+		{
+		fprintf(stderr,"fork failed : \"%s\".\n",strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return;
+		}
+	if(pid==0)
+		{
+		int devnull=open("/dev/null",O_RDWR);
+		dup2(fds[1],STDOUT_FILENO);
+		if(devnull>=0)
+			{
+			dup2(devnull,STDIN_FILENO);
+			dup2(devnull,STDERR_FILENO);
+			}
+		close(fds[0]);
+		close(fds[1]);
+		setenv("LC_ALL","C",1);
+		execlp("make","make","-C",s->watch_dir,"-nd",(char*)NULL);
+		_exit(127);
+		}
+	close(fds[1]);
+	fcntl(fds[0],F_SETFD,FD_CLOEXEC);
+	s->retrace_fd=fds[0];
+	s->retrace_pid=pid;
+	s->retrace_pending=0;
+	s->next_graph=GraphNew(s->opts);
+	}
+
+/** ends the background make, the new graph replaces the old one if it was parsed */
+static void ServerRetraceEnd(ServerPtr s)
+	{
+	int status=0;
+	close(s->retrace_fd);
+	s->retrace_fd=-1;
+	/* a budget was reached, the rest of the output is not needed */
+	if(GraphFeedDone(s->next_graph)) kill(s->retrace_pid,SIGTERM);
+	waitpid(s->retrace_pid,&status,0);
+	if(GraphFeedEnd(s->next_graph)!=0)
+		{
+		fprintf(stderr,"retrace failed: %s\n",GraphError(s->next_graph));
+		GraphFree(s->next_graph);
+		}
+	else if(GraphTruncated(s->next_graph)==NULL && (!WIFEXITED(status) || WEXITSTATUS(status)!=0))
+		{
+		fprintf(stderr,"retrace failed: make exited with status %d\n",status);
+		GraphFree(s->next_graph);
+		}
+	else
+		{
+		GraphFree(s->graph);
+		s->graph=s->next_graph;
+		ServerWatch(s);
+		}
+	s->next_graph=NULL;
+	if(s->retrace_pending) ServerRetrace(s);
+	}
+
+/** reads the output of the background make */
+static void ServerRetraceRead(ServerPtr s)
+	{
+	char buf[65536];
+	ssize_t n=read(s->retrace_fd,buf,sizeof(buf));
+	if(n<0 && errno==EINTR) return;
+	if(n>0)
+		{
+		/* parse errors are checked at the end */
+		GraphFeed(s->next_graph,buf,(size_t)n);
+		if(!GraphFeedDone(s->next_graph)) return;
+		}
+	ServerRetraceEnd(s);
+	}
+
+/** handles the inotify events. A changed source marks its dependents as dirty; a changed
+ * target having prerequisites (e.g. rewritten by make) can also become clean, so the graph is
+ * traced again once the changes stop, as after an overflow of the event queue.
+ * A changed makefile is traced again immediately. */
+static void ServerNotify(ServerPtr s)
+	{
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t n;
+	int retrace=0;
+	TargetPtr* changed=NULL;
+	size_t changed_count=0UL;
+	while((n=read(s->inotify_fd,buf,sizeof(buf)))>0)
+		{
+		char* p;
+		for(p=buf;p< buf+n;p+=sizeof(struct inotify_event)+((struct inotify_event*)p)->len)
+			{
+			const struct inotify_event* e=(const struct inotify_event*)p;
+			WatchedFile key;
+			WatchedFilePtr f;
+			TargetPtr t;
+			size_t i;
+			if(e->mask & IN_Q_OVERFLOW)
+				{
+				/* some changes were lost, only a new trace can tell what is dirty */
+				s->retrace_at=ServerNow()+RETRACE_DELAY;
+				if(s->retrace_fd>=0) s->retrace_pending=1;
+				continue;
+				}
+			if(e->len==0) continue;
+			for(i=0;i< s->dir_count;++i)
+				{
+				if(s->dirs[i].wd==e->wd) break;
+				}
+			if(i==s->dir_count) continue;
+			key.path=ServerJoin(s->dirs[i].path,e->name);
+			f=(WatchedFilePtr)bsearch(&key,s->files,s->file_count,sizeof(WatchedFile),WatchedFileCmp);
+			free(key.path);
+			if(f==NULL) continue;
+			if(f->is_makefile)
+				{
+				retrace=1;
+				continue;
+				}
+			t=GraphFindTarget(s->graph,f->name);
+			if(t==NULL) continue;
+			if(TargetChildCount(t)>0)
+				{
+				s->retrace_at=ServerNow()+RETRACE_DELAY;
+				}
+			/* the running make may not have seen this change */
+			if(s->retrace_fd>=0) s->retrace_pending=1;
+			changed=(TargetPtr*)realloc(changed,sizeof(TargetPtr)*(changed_count+1));
+			if(changed==NULL) OUT_OF_MEMORY;
+			changed[changed_count++]=t;
+			}
+		}
+	/* one traversal for the whole batch of events */
+	if(changed_count>0) GraphInvalidateTargets(s->graph,changed,changed_count);
+	free(changed);
+	if(retrace) ServerRetrace(s);
+	}
+
+/** answers an error to the client */
+static void ServerReplyError(GraphSinkPtr sink,const char* msg)
+	{
+	sink->write(sink->ctx,"error: ",7);
+	sink->write(sink->ctx,msg,strlen(msg));
+	sink->write(sink->ctx,"\n",1);
+	}
+
+/** a sink appending to the answer of the client given as 'ctx' */
+static int ClientSinkWrite(void* ctx,const char* data,size_t len)
+	{
+	ClientPtr c=(ClientPtr)ctx;
+	if(c->answer_len+len > c->answer_capacity)
+		{
+		while(c->answer_len+len > c->answer_capacity)
+			{
+			c->answer_capacity=(c->answer_capacity==0?BUFSIZ:c->answer_capacity*2);
+			}
+		c->answer=(char*)realloc(c->answer,c->answer_capacity);
+		if(c->answer==NULL) OUT_OF_MEMORY;
+		}
+	memcpy(&c->answer[c->answer_len],data,len);
+	c->answer_len+=len;
+	return 0;
+	}
+
+/** answers the request of a client, the answer is buffered and sent by ServerClientWrite */
+static void ServerRequest(ServerPtr s,ClientPtr c)
+	{
+	char* line=c->request;
+	GraphSink sink={ClientSinkWrite,c};
+	char* arg;
+	size_t i;
+
+	/* the answer is not NULL anymore: the client now waits for it */
+	c->answer_capacity=BUFSIZ;
+	c->answer=(char*)malloc(c->answer_capacity);
+	if(c->answer==NULL) OUT_OF_MEMORY;
+	line[c->request_len]=0;
+	line[strcspn(line,"\r\n")]=0;
+	arg=strchr(line,' ');
+	if(arg!=NULL) *arg++=0;
+
+	if(strcmp(line,"list")==0)
+		{
+		DumpGraphAsList(s->graph,&sink);
+		}
+	else if(strcmp(line,"dirty")==0)
+		{
+		char* name=NULL;
+		size_t name_size=0UL;
+		for(i=0;i< GraphTargetCount(s->graph);++i)
+			{
+			TargetPtr t=GraphTargetAt(s->graph,i);
+			size_t n;
+			if(!TargetMustRemake(t)) continue;
+			n=TargetName(t,name,name_size);
+			if(n>=name_size)
+				{
+				name_size=n+1;
+				name=(char*)realloc(name,name_size);
+				if(name==NULL) OUT_OF_MEMORY;
+				TargetName(t,name,name_size);
+				}
+			name[n]='\n';
+			if(sink.write(sink.ctx,name,n+1)!=0) break;
+			}
+		free(name);
+		}
+	else if(strcmp(line,"dump")==0)
+		{
+		int format=(arg==NULL?output_dot:GraphParseFormat(arg));
+		if(format<0) ServerReplyError(&sink,"bad format");
+		else GraphDump(s->graph,format,&sink);
+		}
+	else if(strcmp(line,"focus")==0)
+		{
+		char* name=(arg==NULL?NULL:strchr(arg,' '));
+		int format;
+		TargetPtr t;
+		if(name==NULL)
+			{
+			ServerReplyError(&sink,"usage: focus FORMAT TARGET");
+			return;
+			}
+		*name++=0;
+		format=GraphParseFormat(arg);
+		t=GraphFindTarget(s->graph,name);
+		if(format<0)
+			{
+			ServerReplyError(&sink,"bad format");
+			}
+		else if(t==NULL)
+			{
+			ServerReplyError(&sink,"no such target");
+			}
+		else
+			{
+			GraphPtr sub=GraphFocus(s->graph,t);
+			GraphDump(sub,format,&sink);
+			GraphFree(sub);
+			}
+		}
+	else if(strcmp(line,"retrace")==0)
+		{
+		if(s->watch_dir==NULL)
+			{
+			ServerReplyError(&sink,"no --watch directory");
+			}
+		else
+			{
+			ServerRetrace(s);
+			sink.write(sink.ctx,"ok\n",3);
+			}
+		}
+	else
+		{
+		ServerReplyError(&sink,"unknown request");
+		}
+	}
+
+/** disconnects the i-th client */
+static void ServerClientClose(ServerPtr s,size_t i)
+	{
+	close(s->clients[i].fd);
+	free(s->clients[i].answer);
+	s->clients[i]=s->clients[--s->client_count];
+	}
+
+/** accepts a new client */
+static void ServerAccept(ServerPtr s,int listen_fd)
+	{
+	ClientPtr c;
+	int fd=accept(listen_fd,NULL,NULL);
+	if(fd<0) return;
+	fcntl(fd,F_SETFD,FD_CLOEXEC);
+	fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)|O_NONBLOCK);
+	s->clients=(ClientPtr)realloc(s->clients,sizeof(Client)*(s->client_count+1));
+	if(s->clients==NULL) OUT_OF_MEMORY;
+	c=&s->clients[s->client_count++];
+	memset(c,0,sizeof(Client));
+	c->fd=fd;
+	c->deadline=ServerNow()+CLIENT_TIMEOUT;
+	}
+
+/** reads the request of the i-th client, answers it once it is complete. returns -1 if the client must be closed */
+static int ServerClientRead(ServerPtr s,size_t i)
+	{
+	ClientPtr c=&s->clients[i];
+	ssize_t n=read(c->fd,c->request+c->request_len,sizeof(c->request)-1-c->request_len);
+	if(n<0) return (errno==EINTR || errno==EAGAIN ? 0 : -1);
+	if(n>0)
+		{
+		c->request_len+=(size_t)n;
+		c->deadline=ServerNow()+CLIENT_TIMEOUT;
+		if(memchr(c->request,'\n',c->request_len)==NULL && c->request_len+1< sizeof(c->request)) return 0;
+		}
+	/* end of line, end of file or full buffer */
+	ServerRequest(s,c);
+	return 0;
+	}
+
+/** sends the answer of the i-th client. returns -1 if the client must be closed */
+static int ServerClientWrite(ServerPtr s,size_t i)
+	{
+	ClientPtr c=&s->clients[i];
+	ssize_t n=write(c->fd,c->answer+c->answer_sent,c->answer_len-c->answer_sent);
+	if(n<0) return (errno==EINTR || errno==EAGAIN ? 0 : -1);
+	c->answer_sent+=(size_t)n;
+	c->deadline=ServerNow()+CLIENT_TIMEOUT;
+	return c->answer_sent< c->answer_len ? 0 : -1;
+	}
+
+/** creates the listening socket */
+static int ServerListen(const char* socket_path)
+	{
+	struct sockaddr_un addr;
+	int fd;
+	if(strlen(socket_path)>=sizeof(addr.sun_path))
+		{
+		fprintf(stderr,"Socket path too long \"%s\".\n",socket_path);
+		return -1;
+		}
+	fd=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+	if(fd<0)
+		{
+		fprintf(stderr,"Cannot create socket : \"%s\".\n",strerror(errno));
+		return -1;
+		}
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path,socket_path);
+	unlink(socket_path);
+	if(bind(fd,(struct sockaddr*)&addr,sizeof(addr))!=0 || listen(fd,16)!=0)
+		{
+		fprintf(stderr,"Cannot listen on \"%s\" : \"%s\".\n",socket_path,strerror(errno));
+		close(fd);
+		return -1;
+		}
+	return fd;
+	}
+
+int GraphServe(GraphPtr g,const GraphOptions* opts,const char* socket_path,const char* watch_dir)
+	{
+	Server server;
+	ServerPtr s=&server;
+	struct sigaction sa;
+	int listen_fd;
+
+	memset(s,0,sizeof(Server));
+	s->graph=g;
+	s->opts=opts;
+	s->watch_dir=watch_dir;
+	s->inotify_fd=-1;
+	s->retrace_fd=-1;
+
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler=ServerSignal;
+	sigaction(SIGINT,&sa,NULL);
+	sigaction(SIGTERM,&sa,NULL);
+	signal(SIGPIPE,SIG_IGN);
+
+	listen_fd=ServerListen(socket_path);
+	if(listen_fd<0 || ServerWatch(s)!=0)
+		{
+		if(listen_fd>=0) close(listen_fd);
+		ServerUnwatch(s);
+		GraphFree(s->graph);
+		return -1;
+		}
+
+	while(!server_stop)
+		{
+		struct pollfd fds[3+MAX_CLIENTS];
+		nfds_t n=0;
+		size_t i;
+		double now=ServerNow(),next=-1;
+		int timeout=-1;
+		/* the pending connections wait in the backlog when there are too many clients */
+		fds[n].fd=(s->client_count< MAX_CLIENTS ? listen_fd : -1);
+		fds[n++].events=POLLIN;
+		fds[n].fd=s->inotify_fd;
+		fds[n++].events=POLLIN;
+		fds[n].fd=s->retrace_fd;
+		fds[n++].events=POLLIN;
+		for(i=0;i< s->client_count;++i)
+			{
+			fds[n].fd=s->clients[i].fd;
+			fds[n++].events=(s->clients[i].answer==NULL?POLLIN:POLLOUT);
+			if(next<0 || s->clients[i].deadline< next) next=s->clients[i].deadline;
+			}
+		if(s->retrace_at>0 && (next<0 || s->retrace_at< next)) next=s->retrace_at;
+		/* the --timeout of the background make */
+		if(s->retrace_fd>=0)
+			{
+			double left=GraphTimeLeft(s->next_graph);
+			if(left>=0 && (next<0 || now+left< next)) next=now+left;
+			}
+		if(next>=0) timeout=(next<=now?0:(int)((next-now)*1000)+1);
+		if(poll(fds,n,timeout)<0)
+			{
+			if(errno==EINTR) continue;
+			fprintf(stderr,"poll failed : \"%s\".\n",strerror(errno));
+			break;
+			}
+		now=ServerNow();
+		if(fds[2].revents!=0) ServerRetraceRead(s);
+		else if(s->retrace_fd>=0 && GraphTimeLeft(s->next_graph)==0) ServerRetraceEnd(s);
+		if(fds[1].revents!=0) ServerNotify(s);
+		if(s->retrace_at>0 && s->retrace_at<=now)
+			{
+			s->retrace_at=0;
+			ServerRetrace(s);
+			}
+		/* from the last client, ServerClientClose moves the last client to i */
+		for(i=s->client_count;i>0;--i)
+			{
+			ClientPtr c=&s->clients[i-1];
+			short revents=fds[3+i-1].revents;
+			int ret=0;
+			if(revents & (POLLERR|POLLNVAL)) ret=-1;
+			else if(c->answer==NULL && (revents & (POLLIN|POLLHUP))) ret=ServerClientRead(s,i-1);
+			else if(c->answer!=NULL && (revents & (POLLOUT|POLLHUP))) ret=ServerClientWrite(s,i-1);
+			else if(c->deadline<=now) ret=-1;
+			if(ret!=0) ServerClientClose(s,i-1);
+			}
+		if(fds[0].revents & POLLIN) ServerAccept(s,listen_fd);
+		}
+
+	while(s->client_count>0) ServerClientClose(s,s->client_count-1);
+	free(s->clients);
+	close(listen_fd);
+	unlink(socket_path);
+	if(s->retrace_fd>=0)
+		{
+		close(s->retrace_fd);
+		kill(s->retrace_pid,SIGTERM);
+		waitpid(s->retrace_pid,NULL,0);
+		GraphFree(s->next_graph);
+		}
+	ServerUnwatch(s);
+	GraphFree(s->graph);
+	return 0;
+	}
+
+#else
+
+int GraphServe(GraphPtr g,const GraphOptions* opts,const char* socket_path,const char* watch_dir)
+	{
+	fprintf(stderr,"--serve is only available on Linux.\n");
+	GraphFree(g);
+	return -1;
+	}
+
+#endif
@@ -0,0 +1,40 @@
+/* The MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+   BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+
+   contact: Pierre Lindenbaum PhD @yokofakun
+
+   make2graph --serve: keeps a graph in memory and answers queries
+   on a local unix socket.
+*/
+#ifndef MAKE2GRAPH_SERVE_H
+#define MAKE2GRAPH_SERVE_H
+
+#include "make2graph.h"
+
+/** serve 'g' on the unix socket 'socket_path' until SIGINT/SIGTERM.
+ * if 'watch_dir' is not NULL, the files of the graph are watched with inotify
+ * and `make -nd` is run again in 'watch_dir' when a makefile changes.
+ * 'g' is owned by the server. returns 0 on success.
+ */
+int GraphServe(GraphPtr g,const GraphOptions* opts,const char* socket_path,const char* watch_dir);
+
+#endif